@@ -6,15 +6,29 @@ in vec2 tc;	// used for texture coordinate visualization
 // output of the fragment shader
 out vec4 fragColor;
 
-// shader's global variables, called the uniform variables
+// permutations: SOLID_COLOR selects the visualization at compile time;
+// DYNAMIC_BRANCHES keeps the uniform branch of the single-program shader for comparison
+#ifdef DYNAMIC_BRANCHES
 uniform int solid_color;
+#endif
+#ifndef SOLID_COLOR
+#define SOLID_COLOR 0
+#endif
 
 void main()
 {
+#if defined(DYNAMIC_BRANCHES)
 	if(solid_color == 0)
 		fragColor = vec4(tc.xy,0,1);
 	else if(solid_color == 1)
 		fragColor = vec4(tc.xxx, 1);
 	else if(solid_color == 2)
 		fragColor = vec4(tc.yyy, 1);
+#elif SOLID_COLOR == 1
+	fragColor = vec4(tc.xxx, 1);
+#elif SOLID_COLOR == 2
+	fragColor = vec4(tc.yyy, 1);
+#else
+	fragColor = vec4(tc.xy,0,1);
+#endif
 }
\ No newline at end of file
@@ -1,4 +1,7 @@
 #version 130
+#ifdef UNIFORM_BLOCKS
+#extension GL_ARB_uniform_buffer_object : require
+#endif
 
 // input attributes of vertices
 in vec3 position;	
@@ -10,25 +13,36 @@ in vec2 texcoord;
 out vec3 norm;	// the second output: not used yet
 out vec2 tc;	// the third output: not used yet
 
-// uniform variables
+// uniform variables: the host folds the model, radius scale, projection and aspect correction into
+// one matrix per object, so a vertex costs a single matrix-vector product
+#if defined(DRAW_BATCH)
+in mat4			model_view_projection;	// the draw's row of the host's batch table: an instanced attribute selected by baseInstance
+#elif defined(UNIFORM_BLOCKS)
+layout(std140) uniform object_block	// written through the host's uniform ring
+{
+	mat4	model_view_projection;
+};
+#else
+uniform mat4	model_view_projection;
+#endif
+
+// SEPARATE_MATRICES keeps the per-vertex concatenation of the separate matrices for comparison
+#ifdef SEPARATE_MATRICES
 uniform float	aspect_ratio;	// to correct a distortion of the shape
 uniform float	radius;			// scale of a circle
 uniform mat4	model_matrix;	// 4x4 transformation matrix: explained later in the lecture
 uniform mat4	projection_matrix;
-uniform bool	bRotation;
+#endif
 
 void main()
 {
-	if(!bRotation)
-	{
-		gl_Position = projection_matrix * vec4( position * radius, 1 );
-		gl_Position.xy *= aspect_ratio>1 ? vec2(1/aspect_ratio,1) : vec2(1,aspect_ratio);
-	}
-	else
-	{
-		gl_Position = projection_matrix * model_matrix * vec4( position * radius, 1 );
-		gl_Position.xy *= aspect_ratio>1 ? vec2(1/aspect_ratio,1) : vec2(1,aspect_ratio);
-	}
+#ifdef SEPARATE_MATRICES
+	gl_Position = projection_matrix * model_matrix * vec4( position * radius, 1 );
+	gl_Position.xy *= aspect_ratio>1 ? vec2(1/aspect_ratio,1) : vec2(1,aspect_ratio);
+#else
+	gl_Position = model_view_projection * vec4( position, 1 );
+#endif
+
 	// another output passed via varying variable
 	norm = normal;
 	tc = texcoord;
@@ -0,0 +1,479 @@
+// cgbench: standalone microbenchmarks of cgmath and cgut host paths (no GPU or window required)
+// build (linux): g++ -O2 -std=c++11 -pthread cgbench.cpp GL/glad.c -o cgbench
+// usage: cgbench [--json <file>] [--filter <substring>] [--repeats <n>] [--mesh-mb <n>] [--mem-cap-mb <n>] [--import-mb <n>]
+#include <chrono>
+#include "cgmath.h"			// slee's simple math library
+#include "cgut.h"			// slee's OpenGL utility
+
+//*******************************************************************
+// benchmark harness
+
+struct bench_result
+{
+	std::string	name;
+	size_t		ops = 0;		// operations per sample
+	int			samples = 0;
+	double		mean = 0;		// ns/op
+	double		stddev = 0;		// ns/op
+	double		min = 0;		// ns/op
+	double		median = 0;		// ns/op
+	size_t		peak_rss = 0;	// bytes, process-wide high-water mark after the benchmark
+};
+
+static std::vector<bench_result>	results;
+static const char*					filter = nullptr;
+static int							repeats = 15;
+static volatile float				sink = 0;	// defeats dead-code elimination of benchmark results
+
+inline bool selected( const char* name ){ return !filter||strstr(name,filter); }
+
+template <class F> void bench( const char* name, size_t ops, F func, int samples=0 )
+{
+	if(!selected(name)) return;
+
+	const int repeats = samples>0 ? min(samples,::repeats) : ::repeats;
+	func();	// warm-up: caches, page faults, lazy allocations
+	std::vector<double> ns(repeats);
+	for( int r=0; r<repeats; r++ )
+	{
+		auto t0 = std::chrono::high_resolution_clock::now();
+		func();
+		auto t1 = std::chrono::high_resolution_clock::now();
+		ns[r] = std::chrono::duration<double,std::nano>(t1-t0).count()/double(ops);
+	}
+
+	bench_result b; b.name=name; b.ops=ops; b.samples=repeats;
+	for( double t : ns ) b.mean += t/repeats;
+	for( double t : ns ) b.stddev += (t-b.mean)*(t-b.mean)/max(repeats-1,1);
+	b.stddev = sqrt(b.stddev);
+	std::sort( ns.begin(), ns.end() );
+	b.min = ns.front();
+	b.median = repeats%2 ? ns[repeats/2] : (ns[repeats/2-1]+ns[repeats/2])*0.5;
+	b.peak_rss = cg_peak_rss();
+	results.push_back(b);
+	printf( "%-28s %10.3f ns/op  +-%8.3f  (min %10.3f, median %10.3f, peak RSS %.1f MB)\n", name, b.mean, b.stddev, b.min, b.median, b.peak_rss/1048576.0 );
+}
+
+bool write_json( const char* path )
+{
+	FILE* fp = fopen( path, "w" ); if(fp==nullptr){ printf( "[error] Unable to open %s\n", path ); return false; }
+	fprintf( fp, "{\n  \"timestamp\": %lld,\n", (long long)time(nullptr) );
+#if defined(_MSC_VER)
+	fprintf( fp, "  \"compiler\": \"msvc %d\",\n", _MSC_VER );
+#elif defined(__VERSION__)
+	fprintf( fp, "  \"compiler\": \"%s\",\n", __VERSION__ );
+#endif
+#ifdef CGMATH_SSE2
+	fprintf( fp, "  \"simd\": \"sse2\",\n" );
+#else
+	fprintf( fp, "  \"simd\": \"none\",\n" );
+#endif
+	fprintf( fp, "  \"unit\": \"ns/op\",\n  \"benchmarks\": [\n" );
+	for( size_t k=0; k<results.size(); k++ )
+	{
+		const bench_result& b=results[k];
+		fprintf( fp, "    { \"name\": \"%s\", \"ops\": %zu, \"samples\": %d, \"mean\": %.4f, \"stddev\": %.4f, \"variance\": %.6f, \"min\": %.4f, \"median\": %.4f, \"peak_rss\": %zu }%s\n",
+			b.name.c_str(), b.ops, b.samples, b.mean, b.stddev, b.stddev*b.stddev, b.min, b.median, b.peak_rss, k+1<results.size()?",":"" );
+	}
+	fprintf( fp, "  ]\n}\n" );
+	fclose(fp);
+	return true;
+}
+
+// deterministic pseudo-random inputs in [-1,1)
+static uint rng_state = 1;
+inline float frand(){ rng_state=rng_state*1664525u+1013904223u; return float(rng_state>>8)/float(1<<23)-1.0f; }
+
+//*******************************************************************
+// vectors: arithmetic, normalize, cross
+void bench_vectors()
+{
+	const size_t n = 1<<16;
+	std::vector<vec2> a2(n), b2(n); std::vector<vec3> a3(n), b3(n); std::vector<vec4> a4(n), b4(n);
+	for( size_t k=0; k<n; k++ )
+	{
+		a2[k]=vec2(frand(),frand()); b2[k]=vec2(frand(),frand());
+		a3[k]=vec3(frand(),frand(),frand()); b3[k]=vec3(frand(),frand(),frand());
+		a4[k]=vec4(frand(),frand(),frand(),frand()); b4[k]=vec4(frand(),frand(),frand(),frand());
+	}
+
+	bench( "vec2/add_mul", n, [&](){ for( size_t k=0; k<n; k++ ) a2[k]=a2[k]*0.5f+b2[k]; sink=a2[n/2].x; } );
+	bench( "vec3/add_mul", n, [&](){ for( size_t k=0; k<n; k++ ) a3[k]=a3[k]*0.5f+b3[k]; sink=a3[n/2].x; } );
+	bench( "vec4/add_mul", n, [&](){ for( size_t k=0; k<n; k++ ) a4[k]=a4[k]*0.5f+b4[k]; sink=a4[n/2].x; } );
+	bench( "vec2/dot", n, [&](){ float s=0; for( size_t k=0; k<n; k++ ) s+=dot(a2[k],b2[k]); sink=s; } );
+	bench( "vec3/dot", n, [&](){ float s=0; for( size_t k=0; k<n; k++ ) s+=dot(a3[k],b3[k]); sink=s; } );
+	bench( "vec4/dot", n, [&](){ float s=0; for( size_t k=0; k<n; k++ ) s+=dot(a4[k],b4[k]); sink=s; } );
+	bench( "vec2/normalize", n, [&](){ for( size_t k=0; k<n; k++ ) b2[k]=(a2[k]+1.5f).normalize(); sink=b2[n/2].x; } );
+	bench( "vec3/normalize", n, [&](){ for( size_t k=0; k<n; k++ ) b3[k]=(a3[k]+1.5f).normalize(); sink=b3[n/2].x; } );
+	bench( "vec4/normalize", n, [&](){ for( size_t k=0; k<n; k++ ) b4[k]=(a4[k]+1.5f).normalize(); sink=b4[n/2].x; } );
+	bench( "vec3/cross", n, [&](){ for( size_t k=0; k<n; k++ ) a3[k]=cross(a3[k],b3[k]).normalize(); sink=a3[n/2].x; } );
+}
+
+//*******************************************************************
+// matrices: multiply, inverse, transpose
+void bench_matrices()
+{
+	const size_t n = 1<<14;
+	std::vector<mat3> a3(n), b3(n); std::vector<mat4> a4(n), b4(n); std::vector<vec4> v(n);
+	for( size_t k=0; k<n; k++ )
+	{
+		a4[k] = mat4::rotate(vec3(frand(),frand(),frand()+2.0f).normalize(),frand()*PI)*mat4::translate(frand(),frand(),frand());
+		b4[k] = mat4::rotate(vec3(frand()+2.0f,frand(),frand()).normalize(),frand()*PI)*mat4::scale(frand()+2.0f,frand()+2.0f,frand()+2.0f);
+		a3[k] = mat3(a4[k]); b3[k] = mat3(b4[k]); v[k] = vec4(frand(),frand(),frand(),1);
+	}
+
+	bench( "mat3/mul_mat3", n, [&](){ for( size_t k=0; k<n; k++ ) b3[k]=a3[k]*b3[k]; sink=b3[n/2][0]; } );
+	bench( "mat4/mul_mat4", n, [&](){ for( size_t k=0; k<n; k++ ) b4[k]=a4[k]*b4[k]; sink=b4[n/2][0]; } );
+	bench( "mat4/mul_vec4", n, [&](){ for( size_t k=0; k<n; k++ ) v[k]=a4[k]*v[k]; sink=v[n/2].x; } );
+	bench( "mat3/inverse", n, [&](){ for( size_t k=0; k<n; k++ ) b3[k]=a3[k].inverse(); sink=b3[n/2][0]; } );
+	bench( "mat4/inverse", n, [&](){ for( size_t k=0; k<n; k++ ) b4[k]=a4[k].inverse(); sink=b4[n/2][0]; } );
+	bench( "mat3/transpose", n, [&](){ for( size_t k=0; k<n; k++ ) b3[k]=a3[k].transpose(); sink=b3[n/2][1]; } );
+	bench( "mat4/transpose", n, [&](){ for( size_t k=0; k<n; k++ ) b4[k]=a4[k].transpose(); sink=b4[n/2][1]; } );
+}
+
+//*******************************************************************
+// trigonometry: libm vs. fast_sin/fast_cos/fast_sincos
+void bench_trig()
+{
+	const size_t n = 1<<20;
+	std::vector<float> x(n), s(n), c(n);
+	for( size_t k=0; k<n; k++ ) x[k] = -2*PI+4*PI*float(k)/float(n);
+
+	bench( "sincos/libm", n, [&](){ for( size_t k=0; k<n; k++ ){ s[k]=sinf(x[k]); c[k]=cosf(x[k]); } sink=s[n/2]+c[n/3]; } );
+	bench( "sincos/fast_scalar", n, [&](){ for( size_t k=0; k<n; k++ ) fast_sincos(x[k],s[k],c[k]); sink=s[n/2]+c[n/3]; } );
+	bench( "sincos/fast_batch", n, [&](){ fast_sincos(&x[0],&s[0],&c[0],n); sink=s[n/2]+c[n/3]; } );
+}
+
+//*******************************************************************
+// sphere tessellation: cg_tessellate_sphere(), the generator behind main.cpp's update_sphere_vertices()
+void bench_tessellation()
+{
+	std::vector<vertex> vertex_list;
+	for( uint N : { 36u, 1024u } )
+	{
+		size_t ops = size_t(N+1)*(N*2+1);	// per vertex
+		std::string name = "tessellate/N" + std::to_string(N);
+		bench( (name+"_libm").c_str(), ops, [&](){ cg_tessellate_sphere_vertices(N,1.0f,false,vertex_list); sink=vertex_list.back().pos.x; } );
+		bench( (name+"_fast").c_str(), ops, [&](){ cg_tessellate_sphere_vertices(N,1.0f,true,vertex_list); sink=vertex_list.back().pos.x; } );
+	}
+
+	// tessellation cache: generating vertices and indices at high N vs. a hit that maps the stored entry
+	const uint N = 2048; const size_t ops = size_t(N+1)*(N*2+1);
+	if(!selected("tessellate/N2048_generate")&&!selected("tessellate/N2048_cache_hit")) return;
+	std::vector<uint> index_list;
+	auto generate = [&](){ cg_tessellate_sphere( N, 1.0f, false, vertex_list, index_list ); };
+	bench( "tessellate/N2048_generate", ops, [&](){ generate(); sink=float(index_list.back()); }, 5 );
+	if(vertex_list.size()!=ops) generate();
+	cg_sphere_params params = cg_sphere_key( N, 1.0f, false, false );
+	std::string path = cg_tessellation_cache_path( "cgbench_cache", &params, sizeof(params) );
+	if(!cg_save_tessellation( "cgbench_cache", path.c_str(), vertex_list, index_list )) return;
+	std::vector<vertex> cached_vertices; std::vector<uint> cached_indices;
+	bench( "tessellate/N2048_cache_hit", ops, [&](){ cg_load_tessellation( path.c_str(), cached_vertices, cached_indices ); sink=float(cached_indices.back()); }, 5 );
+	if(selected("tessellate/N2048_cache_hit")) printf( "  cache entry %.1f MB: %s\n", (ops*sizeof(vertex)+index_list.size()*sizeof(uint))/1048576.0, cached_vertices.size()==ops&&cached_indices==index_list&&!memcmp(&cached_vertices[0],&vertex_list[0],ops*sizeof(vertex)) ? "identical" : "MISMATCH" );
+	remove(path.c_str());
+#ifdef _WIN32
+	_rmdir("cgbench_cache");
+#else
+	rmdir("cgbench_cache");
+#endif
+}
+
+//*******************************************************************
+// frustum culling of 1M bounding spheres/boxes: scalar vs. SSE2 batch
+void bench_culling()
+{
+	const size_t n = 1000000;
+	frustum f = extract_frustum( mat4::perspective(PI/3,16/9.0f,0.1f,1000.0f)*mat4::lookAt(vec3(0,0,100),vec3(0),vec3(0,1,0)) );
+	std::vector<vec4> spheres(n); std::vector<aabb> boxes(n); std::vector<uint> visible(n);
+	for( size_t k=0; k<n; k++ )
+	{
+		vec3 c = vec3(frand(),frand(),frand())*200.0f; float r = frand()+1.0f;
+		spheres[k] = vec4(c,r); boxes[k].lo = c-r; boxes[k].hi = c+r;
+	}
+
+	size_t count = 0;
+	bench( "cull/sphere_scalar", n, [&](){ count=0; for( size_t k=0; k<n; k++ ){ visible[count]=uint(k); count+=f.contains(vec3(spheres[k].x,spheres[k].y,spheres[k].z),spheres[k].w)?1:0; } sink=float(count); } );
+	bench( "cull/sphere_batch", n, [&](){ count=cull_spheres(f,&spheres[0],n,&visible[0]); sink=float(count); } );
+	bench( "cull/aabb_scalar", n, [&](){ count=0; for( size_t k=0; k<n; k++ ){ visible[count]=uint(k); count+=f.contains(boxes[k])?1:0; } sink=float(count); } );
+	bench( "cull/aabb_batch", n, [&](){ count=cull_aabbs(f,&boxes[0],n,&visible[0]); sink=float(count); } );
+}
+
+//*******************************************************************
+// half-float and packed-vertex conversions over 1M interleaved vertices
+void bench_packing()
+{
+	const size_t n = 1<<20;
+	std::vector<vertex> v(n); std::vector<packed_vertex> p(n); std::vector<float> f(n*4); std::vector<ushort> h(n*4);
+	for( size_t k=0; k<n; k++ )
+	{
+		float t=float(k)/float(n), a=t*PI, b=t*2*PI*64;
+		v[k].norm = vec3(sin(a)*cos(b),sin(a)*sin(b),cos(a)); v[k].pos = v[k].norm; v[k].tex = vec2(t,1-t);
+	}
+	for( size_t k=0; k<n*4; k++ ) f[k] = (float(k%20000)-10000.0f)*0.37f;
+
+	bench( "pack/float_to_half_scalar", n*4, [&](){ for( size_t k=0; k<n*4; k++ ) h[k]=float_to_half(f[k]); sink=h[n]; } );
+	bench( "pack/float_to_half_batch", n*4, [&](){ float_to_half(&f[0],&h[0],n*4); sink=h[n]; } );
+	bench( "pack/half_to_float_scalar", n*4, [&](){ for( size_t k=0; k<n*4; k++ ) f[k]=half_to_float(h[k]); sink=f[n]; } );
+	bench( "pack/half_to_float_batch", n*4, [&](){ half_to_float(&h[0],&f[0],n*4); sink=f[n]; } );
+	bench( "pack/snorm_1010102_scalar", n, [&](){ for( size_t k=0; k<n; k++ ) p[k].norm=pack_snorm_1010102(v[k].norm); sink=float(p[n/2].norm); } );
+	bench( "pack/snorm_1010102_batch", n, [&](){ pack_snorm_1010102(&v[0].norm,&p[0].norm,n,sizeof(vertex),sizeof(packed_vertex)); sink=float(p[n/2].norm); } );
+	bench( "pack/oct_encode_scalar", n, [&](){ for( size_t k=0; k<n; k++ ) p[k].norm=oct_encode(v[k].norm); sink=float(p[n/2].norm); } );
+	bench( "pack/oct_encode_batch", n, [&](){ oct_encode(&v[0].norm,&p[0].norm,n,sizeof(vertex),sizeof(packed_vertex)); sink=float(p[n/2].norm); } );
+	bench( "pack/unorm16x2_scalar", n, [&](){ for( size_t k=0; k<n; k++ ) p[k].tex=pack_unorm16x2(v[k].tex); sink=float(p[n/2].tex); } );
+	bench( "pack/unorm16x2_batch", n, [&](){ pack_unorm16x2(&v[0].tex,&p[0].tex,n,sizeof(vertex),sizeof(packed_vertex)); sink=float(p[n/2].tex); } );
+}
+
+//*******************************************************************
+// mesh codec: compression ratio and decode throughput against the raw container sections
+void bench_codec()
+{
+	if(!selected("codec/")) return;
+	const uint N = 1024; std::vector<vertex> v; std::vector<uint> index;
+	cg_tessellate_sphere_vertices( N, 1.0f, false, v );
+	for( uint i=0; i<N; i++ ) for( uint k=0; k<N*2; k++ )
+	{
+		uint a=(N*2+1)*i+k, b=a+N*2+1;
+		uint t[6] = { a+1, b, b+1, b, a+1, a }; index.insert( index.end(), t, t+6 );
+	}
+	aabb box = { vec3(-1), vec3(1) };
+	std::vector<uchar> ev, ei; cg_encode_vertices( &v[0], v.size(), box, ev ); cg_encode_indices( &index[0], index.size(), ei );
+	size_t raw_v=v.size()*sizeof(vertex), raw_i=index.size()*sizeof(uint);
+	std::vector<vertex> dv(v.size()); std::vector<uint> di(index.size()); std::vector<char> copy(raw_v+raw_i);
+
+	bench( "codec/raw_copy", v.size(), [&](){ memcpy( &copy[0], &v[0], raw_v ); memcpy( &copy[raw_v], &index[0], raw_i ); sink=copy[raw_v/2]; }, 5 );
+	bench( "codec/decode_vertices", v.size(), [&](){ cg_decode_vertices( &ev[0], ev.size(), box, &dv[0], dv.size() ); sink=dv[v.size()/2].pos.x; }, 5 );
+	bench( "codec/decode_indices", index.size(), [&](){ cg_decode_indices( &ei[0], ei.size(), &di[0], di.size() ); sink=float(di[index.size()/2]); }, 5 );
+	bench( "codec/encode", v.size(), [&](){ std::vector<uchar> e; cg_encode_vertices( &v[0], v.size(), box, e ); cg_encode_indices( &index[0], index.size(), e ); sink=float(e.size()); }, 3 );
+
+	float err = 0; for( size_t k=0; k<v.size(); k++ ) err = max(err,length(dv[k].pos-v[k].pos));
+	printf( "  %zu vertices: %.1f MB -> %.1f MB (ratio %.2f; vertices %.2f, indices %.2f), max position error %g, indices %s\n",
+		v.size(), (raw_v+raw_i)/1048576.0, (ev.size()+ei.size())/1048576.0, double(raw_v+raw_i)/(ev.size()+ei.size()),
+		double(raw_v)/ev.size(), double(raw_i)/ei.size(), err, di==index ? "exact" : "MISMATCH" );
+	for( auto& b : results ) if(b.name=="codec/decode_vertices"||b.name=="codec/decode_indices"||b.name=="codec/raw_copy")
+		printf( "  %-26s %.2f GB/s of decoded output\n", b.name.c_str(), (b.name=="codec/decode_indices"?4.0:b.name=="codec/raw_copy"?double(raw_v+raw_i)/v.size():32.0)/b.median );
+
+	// compressed files pass the loader's validation, with and without indices
+	const char* path = "cgbench_codec.cgmesh"; std::vector<uint> no_index;
+	for( const std::vector<uint>* in : { &index, &no_index } )
+	{
+		bool ok = cg_save_mesh_file( path, v, *in, false, CG_CODEC_QLZ );
+		mmap_t m = cg_map_binary(path); ok = ok&&m.ptr&&cg_validate_mesh_header( m, path ); cg_unmap_binary(m);
+		printf( "  save/validate %s: %s\n", in->empty() ? "without indices" : "indexed", ok ? "ok" : "FAILED" );
+	}
+	remove(path);
+}
+
+//*******************************************************************
+// mesh pool: a scene of many small meshes (host side) with new+vectors vs. cg_mesh_pool, including unload
+void bench_mesh_pool()
+{
+	const size_t count = 4096, vn = 24, in = 36; // cube-sized meshes
+	std::vector<vertex> v(vn); std::vector<uint> i(in);
+	for( size_t k=0; k<vn; k++ ){ v[k].pos=vec3(frand(),frand(),frand()); v[k].norm=v[k].pos.normalize(); v[k].tex=vec2(frand(),frand()); }
+	for( size_t k=0; k<in; k++ ) i[k]=uint(k%vn);
+
+	std::vector<mesh*> scene; scene.reserve(count);
+	bench( "mesh_pool/new_vectors", count, [&](){
+		for( size_t k=0; k<count; k++ ){ mesh* m=new mesh(); m->vertex_list=v; m->index_list=i; m->vertex_count=vn; m->index_count=in; scene.push_back(m); }
+		sink=scene.back()->vertex_list[0].pos.x;
+		for( mesh* m : scene ) delete m;
+		scene.clear();
+	}, 5 );
+	size_t allocations = 0, requests = 0;
+	bench( "mesh_pool/arena", count, [&](){
+		cg_mesh_pool pool; pool.arena.block_size = 1<<20;
+		for( size_t k=0; k<count; k++ ){ mesh* m=pool.create(vn,in); std::copy( v.begin(), v.end(), m->vertices ); memcpy( m->indices, &i[0], in*sizeof(uint) ); }
+		sink=pool.meshes.back()->vertices[0].pos.x;
+		allocations = pool.arena.allocations; requests = pool.arena.requests;
+	}, 5 );
+	if(selected("mesh_pool/")) printf( "  %zu meshes: %zu heap allocations with new+vectors, %zu arena blocks for %zu pool requests (plus the growth of the mesh list)\n", count, count*3, allocations, requests );
+}
+
+//*******************************************************************
+// sub-allocation: first-fit alloc/free churn over a shared buffer's byte range (host bookkeeping of cg_shared_buffers)
+void bench_suballocation()
+{
+	const size_t n = 1<<14, live = 4096;
+	std::vector<std::pair<size_t,size_t>> slots(live,std::make_pair(SIZE_MAX,size_t(0)));
+	std::vector<size_t> sizes(n); for( auto& s : sizes ) s = (1+size_t((frand()*0.5f+0.5f)*63))*32; // 1..64 vertices of 32 bytes
+	cg_range_allocator a; size_t failed = 0;
+	bench( "suballoc/churn", n, [&](){
+		a.reset( live*32*40 ); for( auto& s : slots ) s.first = SIZE_MAX; failed = 0;
+		for( size_t k=0; k<n; k++ )
+		{
+			auto& s = slots[(k*2654435761u)%live];
+			if(s.first!=SIZE_MAX) a.free( s.first, s.second );
+			s.second = sizes[k]; s.first = a.alloc( s.second, 32 ); if(s.first==SIZE_MAX) failed++;
+		}
+	}, 5 );
+	if(selected("suballoc/churn")) printf( "  %zu free ranges, largest %.1f KB of %.1f KB free, %zu failed allocations\n", a.free_ranges.size(), a.largest_free()/1024.0, a.free_bytes()/1024.0, failed );
+}
+
+//*******************************************************************
+// mesh loading: read+copy into vertex_list vs. mapped pages (host side of cg_load_mesh)
+// peak RSS only grows within a process, so compare paths in separate runs via --filter
+inline uint checksum( const char* p, size_t size ){ uint s=0; for( size_t k=0; k<size; k+=4096 ) s+=uint(p[k]); return s; } // touches every page as glBufferData would
+
+void bench_mesh_loading( size_t mesh_mb )
+{
+	if(mesh_mb==0||!(selected("mesh/load_read_copy")||selected("mesh/load_mmap_copy")||selected("mesh/load_mmap_nocopy"))) return;
+	const char* path = "cgbench_mesh.vert.bin";
+	const size_t n = mesh_mb*1048576/sizeof(vertex);
+	FILE* fp = fopen( path, "wb" ); if(fp==nullptr){ printf( "[error] Unable to open %s\n", path ); return; }
+	std::vector<vertex> chunk(1<<16);
+	for( size_t k=0; k<n; k+=chunk.size() )
+	{
+		for( auto& v : chunk ){ v.pos=vec3(frand(),frand(),frand()); v.norm=v.pos.normalize(); v.tex=vec2(frand(),frand()); }
+		fwrite( &chunk[0], sizeof(vertex), min(chunk.size(),n-k), fp );
+	}
+	fclose(fp);
+
+	bench( "mesh/load_read_copy", n, [&](){
+		mem_t m = cg_read_binary(path); if(m.ptr==nullptr) return;
+		std::vector<vertex> vertex_list( (const vertex*) m.ptr, (const vertex*) m.ptr + m.size/sizeof(vertex) );
+		free(m.ptr); sink=float(checksum((const char*)&vertex_list[0],vertex_list.size()*sizeof(vertex)));
+	}, 3 );
+	bench( "mesh/load_mmap_copy", n, [&](){
+		mmap_t m = cg_map_binary(path); if(m.ptr==nullptr) return;
+		std::vector<vertex> vertex_list( (const vertex*) m.ptr, (const vertex*) m.ptr + m.size/sizeof(vertex) );
+		cg_unmap_binary(m); sink=float(checksum((const char*)&vertex_list[0],vertex_list.size()*sizeof(vertex)));
+	}, 3 );
+	bench( "mesh/load_mmap_nocopy", n, [&](){
+		mmap_t m = cg_map_binary(path); if(m.ptr==nullptr) return;
+		sink=float(checksum(m.ptr,m.size)); cg_unmap_binary(m);
+	}, 3 );
+	remove(path);
+}
+
+// streaming: a container several times larger than the address-space cap (POSIX only) goes through cg_stream_mesh_file()
+void bench_mesh_streaming( size_t mesh_mb, size_t cap_mb )
+{
+	if(mesh_mb==0||!selected("mesh/stream")) return;
+	const char* path = "cgbench_mesh.cgmesh";
+	const size_t n = mesh_mb*1048576/(sizeof(vertex)+sizeof(uint));
+
+	// write the container in chunks; the header is rewritten once bounds and checksum are known
+	mesh_header h = {};
+	h.magic = CG_MESH_MAGIC; h.version = CG_MESH_VERSION; h.header_size = sizeof(h);
+	h.vertex_layout = CG_LAYOUT_VERTEX; h.vertex_stride = sizeof(vertex); h.index_width = sizeof(uint);
+	h.vertex_count = h.index_count = n;
+	h.vertex_offset = (sizeof(h)+CG_MESH_ALIGN-1)/CG_MESH_ALIGN*CG_MESH_ALIGN;
+	h.vertex_bytes = n*sizeof(vertex); h.index_bytes = n*sizeof(uint);
+	h.index_offset = (h.vertex_offset+h.vertex_bytes+CG_MESH_ALIGN-1)/CG_MESH_ALIGN*CG_MESH_ALIGN;
+	h.file_size = h.index_offset+h.index_bytes;
+	h.box.lo = vec3(-1); h.box.hi = vec3(1); h.sphere = vec4(0,0,0,sqrt(3.0f));
+	FILE* fp = fopen( path, "wb" ); if(fp==nullptr){ printf( "[error] Unable to open %s\n", path ); return; }
+	char pad[CG_MESH_ALIGN] = {0};
+	fwrite( &h, sizeof(h), 1, fp ); fwrite( pad, 1, size_t(h.vertex_offset-sizeof(h)), fp );
+	std::vector<vertex> chunk(1<<16); std::vector<uint> index_chunk(1<<16); uint c = 2166136261u;
+	for( size_t k=0; k<n; k+=chunk.size() )
+	{
+		size_t m = min(chunk.size(),n-k);
+		for( auto& v : chunk ){ v.pos=vec3(frand(),frand(),frand()); v.norm=v.pos.normalize(); v.tex=vec2(frand(),frand()); }
+		fwrite( &chunk[0], sizeof(vertex), m, fp ); c = cg_fnv1a( &chunk[0], m*sizeof(vertex), c );
+	}
+	fwrite( pad, 1, size_t(h.index_offset-h.vertex_offset-n*sizeof(vertex)), fp );
+	for( size_t k=0; k<n; k+=index_chunk.size() )
+	{
+		size_t m = min(index_chunk.size(),n-k);
+		for( size_t j=0; j<m; j++ ) index_chunk[j] = uint((k+j)*7%n);
+		fwrite( &index_chunk[0], sizeof(uint), m, fp ); c = cg_fnv1a( &index_chunk[0], m*sizeof(uint), c );
+	}
+	h.data_checksum = c;
+	h.header_checksum = cg_fnv1a( &h, offsetof(mesh_header,header_checksum) );
+	fseek( fp, 0, SEEK_SET ); fwrite( &h, sizeof(h), 1, fp );
+	fclose(fp);
+
+#ifndef _WIN32
+	struct rlimit saved; getrlimit( RLIMIT_AS, &saved );
+	if(cap_mb){ struct rlimit cap=saved; cap.rlim_cur=rlim_t(cap_mb)*1048576; if(setrlimit(RLIMIT_AS,&cap)) printf( "[error] Unable to set the memory cap\n" ); }
+#endif
+	bool verified = true;
+	bench( "mesh/stream_4mb_chunks", n, [&](){
+		mesh_header sh; uint s = 2166136261u;
+		auto upload = [&]( int, uint64_t, const char* data, size_t size ){ s = cg_fnv1a( data, size, s ); };
+		verified = cg_stream_mesh_file( path, sh, upload ) && s==sh.data_checksum && verified;
+	}, 3 );
+#ifndef _WIN32
+	setrlimit( RLIMIT_AS, &saved );
+#endif
+	if(selected("mesh/stream_4mb_chunks")) printf( "  %zu MB mesh streamed under a %zu MB cap: checksum %s\n", mesh_mb, cap_mb, verified ? "verified" : "FAILED" );
+	remove(path);
+}
+
+//*******************************************************************
+// import: OBJ (v/vt/vn, f a/b/c) and ascii PLY of a grid mesh, parsed by cg_import_mesh() on one thread vs. all cores
+void bench_import( size_t import_mb )
+{
+	const char* names[2][2] = { {"import/obj_1_thread","import/obj_all_threads"}, {"import/ply_1_thread","import/ply_all_threads"} };
+	if(import_mb==0||!(selected(names[0][0])||selected(names[0][1])||selected(names[1][0])||selected(names[1][1]))) return;
+	const char* obj_path = "cgbench_import.obj"; const char* ply_path = "cgbench_import.ply";
+	const size_t cols = 1024, rows = max(size_t(2),import_mb*1048576/(cols*230)); // ~230 bytes of OBJ per grid vertex
+	auto at = [&]( size_t r, size_t c ){ float u=float(c)/float(cols-1), v=float(r)/float(rows-1); return vec3(cos(u*6.2831853f)*sin(v*3.1415927f), sin(u*6.2831853f)*sin(v*3.1415927f), cos(v*3.1415927f)); };
+	FILE* obj = fopen( obj_path, "w" ); FILE* ply = fopen( ply_path, "w" );
+	if(!obj||!ply){ printf( "[error] Unable to open %s\n", obj?ply_path:obj_path ); if(obj) fclose(obj); if(ply) fclose(ply); return; }
+	fprintf( ply, "ply\nformat ascii 1.0\nelement vertex %zu\nproperty float x\nproperty float y\nproperty float z\nproperty float nx\nproperty float ny\nproperty float nz\nproperty float u\nproperty float v\n", rows*cols );
+	fprintf( ply, "element face %zu\nproperty list uchar int vertex_indices\nend_header\n", (rows-1)*(cols-1)*2 );
+	for( size_t r=0; r<rows; r++ ) for( size_t c=0; c<cols; c++ )
+	{
+		vec3 p=at(r,c); float u=float(c)/float(cols-1), v=float(r)/float(rows-1);
+		fprintf( obj, "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n", p.x, p.y, p.z, u, v, p.x, p.y, p.z );
+		fprintf( ply, "%.6f %.6f %.6f %.6f %.6f %.6f %.6f %.6f\n", p.x, p.y, p.z, p.x, p.y, p.z, u, v );
+	}
+	for( size_t r=0; r+1<rows; r++ ) for( size_t c=0; c+1<cols; c++ )
+	{
+		size_t a=r*cols+c+1, b=a+1, d=a+cols, e=d+1; // 1-based in OBJ
+		fprintf( obj, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\nf %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n", a,a,a, d,d,d, b,b,b, b,b,b, d,d,d, e,e,e );
+		fprintf( ply, "3 %zu %zu %zu\n3 %zu %zu %zu\n", a-1, d-1, b-1, b-1, d-1, e-1 );
+	}
+	fclose(obj); fclose(ply);
+
+	const int cores = max(1,int(std::thread::hardware_concurrency()));
+	const char* paths[2] = { obj_path, ply_path };
+	for( int f=0; f<2; f++ )
+	{
+		mmap_t m = cg_map_binary(paths[f]); size_t bytes = m.size; cg_unmap_binary(m);
+		for( int t=0; t<2; t++ )
+		{
+			bool ok = true; size_t vn=0, in=0;
+			bench( names[f][t], bytes, [&](){ std::vector<vertex> v; std::vector<uint> i; ok = cg_import_mesh( paths[f], v, i, t?cores:1 ) && ok; vn=v.size(); in=i.size(); }, 3 );
+			if(!selected(names[f][t])) continue;
+			const bench_result& b = results.back();
+			printf( "  %.1f MB on %d thread(s): %.1f MB/s, %zu vertices, %zu indices%s\n", bytes/1048576.0, t?cores:1, 1e9/(b.median*1048576.0), vn, in, ok&&vn==rows*cols&&in==(rows-1)*(cols-1)*6 ? "" : " [FAILED]" );
+		}
+	}
+	remove(obj_path); remove(ply_path);
+}
+
+//*******************************************************************
+int main( int argc, char* argv[] )
+{
+	const char* json_path = nullptr;
+	size_t mesh_mb = 0, mem_cap_mb = 0, import_mb = 0;
+	for( int k=1; k<argc; k++ )
+	{
+		if(strcmp(argv[k],"--json")==0&&k+1<argc)			json_path = argv[++k];
+		else if(strcmp(argv[k],"--filter")==0&&k+1<argc)	filter = argv[++k];
+		else if(strcmp(argv[k],"--repeats")==0&&k+1<argc){ repeats = atoi(argv[++k]); repeats = max(repeats,1); }
+		else if(strcmp(argv[k],"--mesh-mb")==0&&k+1<argc)	mesh_mb = size_t(atoi(argv[++k]));
+		else if(strcmp(argv[k],"--mem-cap-mb")==0&&k+1<argc)	mem_cap_mb = size_t(atoi(argv[++k]));
+		else if(strcmp(argv[k],"--import-mb")==0&&k+1<argc)	import_mb = size_t(atoi(argv[++k]));
+		else { printf( "usage: %s [--json <file>] [--filter <substring>] [--repeats <n>] [--mesh-mb <n>] [--mem-cap-mb <n>] [--import-mb <n>]\n", argv[0] ); return 1; }
+	}
+
+	bench_vectors();
+	bench_matrices();
+	bench_trig();
+	bench_tessellation();
+	bench_culling();
+	bench_packing();
+	bench_codec();
+	bench_mesh_pool();
+	bench_suballocation();
+	bench_mesh_loading( mesh_mb );
+	bench_mesh_streaming( mesh_mb, mem_cap_mb );
+	bench_import( import_mb );
+
+	if(json_path&&!write_json(json_path)) return 1;
+	return 0;
+}
@@ -14,6 +14,7 @@
 // STL
 #include <algorithm>
 #include <array>
+#include <limits>
 #include <map>
 #include <set>
 #include <string>
@@ -32,6 +33,13 @@
 #elif defined(__GNUC__)&&!defined(__forceinline)
 	#define __forceinline inline __attribute__((__always_inline__))
 #endif
+// SIMD: SSE2 is the baseline for x64 and /arch:SSE2 (VS2012+ default on x86)
+#if defined(__SSE2__)||defined(_M_X64)||(defined(_M_IX86_FP)&&_M_IX86_FP>=2)
+	#include <emmintrin.h>
+	#ifndef CGMATH_SSE2
+		#define CGMATH_SSE2
+	#endif
+#endif
 // common macros
 #ifndef PI
 	#define PI 3.141592653589793f
@@ -249,143 +257,213 @@ using uvec2 = tvec2<uint>;		using uvec3 = tvec3<uint>;		using uvec4 = tvec4<uint
 using dvec2 = tvec2<double>;	using dvec3 = tvec3<double>;	using dvec4 = tvec4<double>;
 
 //*******************************************************************
-// matrix 3x3: uses a standard row-major notation
-struct mat3
+// matrix storage layouts: elements are always named _rc (row r, column c)
+// and constructors take them in the standard row-major notation, so the
+// math API is the same for both; only the memory order of a[] differs.
+// col_major is GL's native order and uploads with transpose=GL_FALSE;
+// define CGMATH_ROW_MAJOR to make row_major the default mat3/mat4 layout.
+struct row_major { static const bool transposed=true;  static inline int index( int row, int col, int n ){ return row*n+col; } };
+struct col_major { static const bool transposed=false; static inline int index( int row, int col, int n ){ return col*n+row; } };
+
+// a strided row of a column-major matrix: reads gather and assignments scatter its elements
+template <class V, int N> struct tmat_row_ref
+{
+	float* a; int row;
+	inline operator V() const { V v; for( int c=0; c<int(sizeof(V)/sizeof(float)); c++ ) v[c]=a[c*N+row]; return v; }
+	inline tmat_row_ref& operator=( const V& v ){ for( int c=0; c<int(sizeof(V)/sizeof(float)); c++ ) a[c*N+row]=v[c]; return *this; }
+	inline tmat_row_ref& operator=( const tmat_row_ref& r ){ return operator=(V(r)); }
+	inline float dot( const V& v ) const { return V(*this).dot(v); }
+};
+
+template <class L> struct tmat3_storage;
+template <> struct tmat3_storage<row_major>
 {
 	union { float a[9]; struct {float _11,_12,_13,_21,_22,_23,_31,_32,_33;}; };
 
-	inline mat3(){ _12=_13=_21=_23=_31=_32=0.0f;_11=_22=_33=1.0f; }
-	inline mat3( float f11, float f12, float f13, float f21, float f22, float f23, float f31, float f32, float f33 ){_11=f11;_12=f12;_13=f13;_21=f21;_22=f22;_23=f23;_31=f31;_32=f32;_33=f33;}
+	// row vectors: contiguous in row-major storage
+	inline vec3& rvec3( int row ){ return reinterpret_cast<vec3&>(a[row*3]); }
+	inline const vec3& rvec3( int row ) const { return reinterpret_cast<const vec3&>(a[row*3]); }
+};
+template <> struct tmat3_storage<col_major>
+{
+	union { float a[9]; struct {float _11,_21,_31,_12,_22,_32,_13,_23,_33;}; };
+
+	// column vectors: contiguous in column-major storage
+	inline vec3& cvec3( int col ){ return reinterpret_cast<vec3&>(a[col*3]); }
+	inline const vec3& cvec3( int col ) const { return reinterpret_cast<const vec3&>(a[col*3]); }
+
+	// row vectors: strided, so copies or tmat_row_ref proxies instead of references
+	inline tmat_row_ref<vec3,3> rvec3( int row ){ tmat_row_ref<vec3,3> r={a,row}; return r; }
+	inline vec3 rvec3( int row ) const { return vec3(a[row],a[3+row],a[6+row]); }
+};
+
+template <class L> struct tmat4_storage;
+template <> struct tmat4_storage<row_major>
+{
+	union { float a[16]; struct {float _11,_12,_13,_14,_21,_22,_23,_24,_31,_32,_33,_34,_41,_42,_43,_44;}; };
+
+	// row vectors: contiguous in row-major storage
+	inline vec4& rvec4( int row ){ return reinterpret_cast<vec4&>(a[row*4]); }
+	inline vec3& rvec3( int row ){ return reinterpret_cast<vec3&>(a[row*4]); }
+	inline const vec4& rvec4( int row ) const { return reinterpret_cast<const vec4&>(a[row*4]); }
+	inline const vec3& rvec3( int row ) const { return reinterpret_cast<const vec3&>(a[row*4]); }
+};
+template <> struct tmat4_storage<col_major>
+{
+	union { float a[16]; struct {float _11,_21,_31,_41,_12,_22,_32,_42,_13,_23,_33,_43,_14,_24,_34,_44;}; };
+
+	// column vectors: contiguous in column-major storage
+	inline vec4& cvec4( int col ){ return reinterpret_cast<vec4&>(a[col*4]); }
+	inline vec3& cvec3( int col ){ return reinterpret_cast<vec3&>(a[col*4]); }
+	inline const vec4& cvec4( int col ) const { return reinterpret_cast<const vec4&>(a[col*4]); }
+	inline const vec3& cvec3( int col ) const { return reinterpret_cast<const vec3&>(a[col*4]); }
+
+	// row vectors: strided, so copies or tmat_row_ref proxies instead of references
+	inline tmat_row_ref<vec4,4> rvec4( int row ){ tmat_row_ref<vec4,4> r={a,row}; return r; }
+	inline tmat_row_ref<vec3,4> rvec3( int row ){ tmat_row_ref<vec3,4> r={a,row}; return r; }
+	inline vec4 rvec4( int row ) const { return vec4(a[row],a[4+row],a[8+row],a[12+row]); }
+	inline vec3 rvec3( int row ) const { return vec3(a[row],a[4+row],a[8+row]); }
+};
+
+//*******************************************************************
+// matrix 3x3: uses a standard row-major notation
+template <class L> struct tmat3 : public tmat3_storage<L>
+{
+	using tmat3_storage<L>::a;
+	using tmat3_storage<L>::_11; using tmat3_storage<L>::_12; using tmat3_storage<L>::_13;
+	using tmat3_storage<L>::_21; using tmat3_storage<L>::_22; using tmat3_storage<L>::_23;
+	using tmat3_storage<L>::_31; using tmat3_storage<L>::_32; using tmat3_storage<L>::_33;
+
+	inline tmat3(){ _12=_13=_21=_23=_31=_32=0.0f;_11=_22=_33=1.0f; }
+	inline tmat3( float f11, float f12, float f13, float f21, float f22, float f23, float f31, float f32, float f33 ){_11=f11;_12=f12;_13=f13;_21=f21;_22=f22;_23=f23;_31=f31;_32=f32;_33=f33;}
 	
 	// comparison operators
-	inline bool operator==( const mat3& m ) const { for( int k=0; k<std::extent<decltype(a)>::value; k++ ) if(std::abs(a[k]-m[k])>precision<float>::value()) return false; return true; }
-	inline bool operator!=( const mat3& m ) const { return !operator==(m); }
+	inline bool operator==( const tmat3& m ) const { for( int k=0; k<std::extent<decltype(a)>::value; k++ ) if(std::abs(a[k]-m[k])>precision<float>::value()) return false; return true; }
+	inline bool operator!=( const tmat3& m ) const { return !operator==(m); }
 
 	// casting operators
 	inline operator float*(){ return a; }
 	inline operator const float*() const { return a; }
 
-	// array access operators
+	// array access operators: raw storage order; use at(row,col) for layout-independent access
 	inline float& operator[]( unsigned i ){ return a[i]; }
 	inline float& operator[]( int i ){ return a[i]; }
 	inline const float& operator[]( unsigned i ) const { return a[i]; }
 	inline const float& operator[]( int i ) const { return a[i]; }
-
-	// row vectors
-	inline vec3& rvec3( int row ){ return reinterpret_cast<vec3&>(a[row*3]); }
-	inline const vec3& rvec3( int row ) const { return reinterpret_cast<const vec3&>(a[row*3]); }
+	inline float& at( int row, int col ){ return a[L::index(row,col,3)]; }
+	inline const float& at( int row, int col ) const { return a[L::index(row,col,3)]; }
 
 	// identity and transpose
-	inline static mat3 identity(){ return mat3(); }
-	inline mat3& setIdentity(){ _12=_13=_21=_23=_31=_32=0.0f;_11=_22=_33=1.0f; return *this; }
-	inline mat3 transpose() const { return mat3(_11,_21,_31,_12,_22,_32,_13,_23,_33); }
+	inline static tmat3 identity(){ return tmat3(); }
+	inline tmat3& setIdentity(){ _12=_13=_21=_23=_31=_32=0.0f;_11=_22=_33=1.0f; return *this; }
+	inline tmat3 transpose() const { return tmat3(_11,_21,_31,_12,_22,_32,_13,_23,_33); }
 
 	// addition/subtraction operators
-	inline mat3 operator+( const mat3& m ) const { mat3 r; for( int k=0; k < std::extent<decltype(a)>::value; k++ ) r[k]=a[k]+m[k]; return r; }
-	inline mat3 operator-( const mat3& m ) const { mat3 r; for( int k=0; k < std::extent<decltype(a)>::value; k++ ) r[k]=a[k]-m[k]; return r; }
-	inline mat3& operator+=( const mat3& m ){ return *this=operator+(m); }
-	inline mat3& operator-=( const mat3& m ){ return *this=operator-(m); }
+	inline tmat3 operator+( const tmat3& m ) const { tmat3 r; for( int k=0; k < std::extent<decltype(a)>::value; k++ ) r[k]=a[k]+m[k]; return r; }
+	inline tmat3 operator-( const tmat3& m ) const { tmat3 r; for( int k=0; k < std::extent<decltype(a)>::value; k++ ) r[k]=a[k]-m[k]; return r; }
+	inline tmat3& operator+=( const tmat3& m ){ return *this=operator+(m); }
+	inline tmat3& operator-=( const tmat3& m ){ return *this=operator-(m); }
 
 	// multiplication operators
-	inline mat3 operator*( float f ) const { mat3 r; for( int k=0; k < std::extent<decltype(a)>::value; k++ ) r[k]=a[k]*f; return r; }
-	inline vec3 operator*( const vec3& v ) const { return vec3(rvec3(0).dot(v), rvec3(1).dot(v), rvec3(2).dot(v)); }
-	inline mat3 operator*( const mat3& m ) const { mat3 t=m.transpose(), r; for(uint k=0;k<3;k++) r.rvec3(k)=t.operator*(rvec3(k)); return r; } // a bit tricky implementation
-	inline mat3& operator*=( const mat3& m ){ return *this=operator*(m); }
+	inline tmat3 operator*( float f ) const { tmat3 r; for( int k=0; k < std::extent<decltype(a)>::value; k++ ) r[k]=a[k]*f; return r; }
+	inline vec3 operator*( const vec3& v ) const { return vec3(_11*v.x+_12*v.y+_13*v.z, _21*v.x+_22*v.y+_23*v.z, _31*v.x+_32*v.y+_33*v.z); }
+	inline tmat3 operator*( const tmat3& m ) const { tmat3 r; for(int i=0;i<3;i++) for(int j=0;j<3;j++) r.at(i,j)=at(i,0)*m.at(0,j)+at(i,1)*m.at(1,j)+at(i,2)*m.at(2,j); return r; }
+	inline tmat3& operator*=( const tmat3& m ){ return *this=operator*(m); }
 
 	// determinant
 	inline float determinant() const { return _11*(_22*_33-_23*_32) + _12*(_23*_31-_21*_33) + _13*(_21*_32-_22*_31); }
 
 	// inverse
-	inline mat3 inverse() const 
+	inline tmat3 inverse() const 
 	{
 		float det=determinant(), s=1.0f/det; if( det==0 ) printf( "mat3::inverse() might be singular.\n" );
-		return mat3( (_22*_33-_32*_23)*s, (_13*_32-_12*_33)*s, (_12*_23-_13*_22)*s, (_23*_31-_21*_33)*s, (_11*_33-_13*_31)*s, (_21*_13-_11*_23)*s, (_21*_32-_31*_22)*s, 	(_31*_12-_11*_32)*s,	 (_11*_22-_21*_12)*s );
+		return tmat3( (_22*_33-_32*_23)*s, (_13*_32-_12*_33)*s, (_12*_23-_13*_22)*s, (_23*_31-_21*_33)*s, (_11*_33-_13*_31)*s, (_21*_13-_11*_23)*s, (_21*_32-_31*_22)*s, 	(_31*_12-_11*_32)*s,	 (_11*_22-_21*_12)*s );
 	}
 };
 
 //*******************************************************************
 // matrix 4x4: uses a standard row-major notation
-struct mat4
+template <class L> struct tmat4 : public tmat4_storage<L>
 {
-	union { float a[16]; struct {float _11,_12,_13,_14,_21,_22,_23,_24,_31,_32,_33,_34,_41,_42,_43,_44;}; };
-
-	mat4(){ _12=_13=_14=_21=_23=_24=_31=_32=_34=_41=_42=_43=0.0f;_11=_22=_33=_44=1.0f; }
-	mat4( float f11, float f12, float f13, float f14, float f21, float f22, float f23, float f24, float f31, float f32, float f33, float f34, float f41, float f42, float f43, float f44 ){_11=f11;_12=f12;_13=f13;_14=f14;_21=f21;_22=f22;_23=f23;_24=f24;_31=f31;_32=f32;_33=f33;_34=f34;_41=f41;_42=f42;_43=f43;_44=f44;}
+	using tmat4_storage<L>::a;
+	using tmat4_storage<L>::_11; using tmat4_storage<L>::_12; using tmat4_storage<L>::_13; using tmat4_storage<L>::_14;
+	using tmat4_storage<L>::_21; using tmat4_storage<L>::_22; using tmat4_storage<L>::_23; using tmat4_storage<L>::_24;
+	using tmat4_storage<L>::_31; using tmat4_storage<L>::_32; using tmat4_storage<L>::_33; using tmat4_storage<L>::_34;
+	using tmat4_storage<L>::_41; using tmat4_storage<L>::_42; using tmat4_storage<L>::_43; using tmat4_storage<L>::_44;
+
+	tmat4(){ _12=_13=_14=_21=_23=_24=_31=_32=_34=_41=_42=_43=0.0f;_11=_22=_33=_44=1.0f; }
+	tmat4( float f11, float f12, float f13, float f14, float f21, float f22, float f23, float f24, float f31, float f32, float f33, float f34, float f41, float f42, float f43, float f44 ){_11=f11;_12=f12;_13=f13;_14=f14;_21=f21;_22=f22;_23=f23;_24=f24;_31=f31;_32=f32;_33=f33;_34=f34;_41=f41;_42=f42;_43=f43;_44=f44;}
 	
 	// comparison operators
-	inline bool operator==( const mat4& m ) const { for( int k=0; k<std::extent<decltype(a)>::value; k++ ) if(std::abs(a[k]-m[k])>precision<float>::value()) return false; return true; }
-	inline bool operator!=( const mat4& m ) const { return !operator==(m); }
+	inline bool operator==( const tmat4& m ) const { for( int k=0; k<std::extent<decltype(a)>::value; k++ ) if(std::abs(a[k]-m[k])>precision<float>::value()) return false; return true; }
+	inline bool operator!=( const tmat4& m ) const { return !operator==(m); }
 
 	// casting operators
 	inline operator float*(){ return a; }
 	inline operator const float*() const { return a; }
-	inline operator mat3() const {return mat3(_11, _12, _13, _21, _22, _23, _31, _32, _33 ); }
+	inline operator tmat3<L>() const {return tmat3<L>(_11, _12, _13, _21, _22, _23, _31, _32, _33 ); }
 
-	// array access operators
+	// array access operators: raw storage order; use at(row,col) for layout-independent access
 	inline float& operator[]( unsigned i ){ return a[i]; }
 	inline float& operator[]( int i ){ return a[i]; }
 	inline const float& operator[]( unsigned i ) const { return a[i]; }
 	inline const float& operator[]( int i ) const { return a[i]; }
-
-	// row vectors
-	inline vec4& rvec4( int row ){ return reinterpret_cast<vec4&>(a[row*4]); }
-	inline vec3& rvec3( int row ){ return reinterpret_cast<vec3&>(a[row*4]); }
-	inline const vec4& rvec4( int row ) const { return reinterpret_cast<const vec4&>(a[row*4]); }
-	inline const vec3& rvec3( int row ) const { return reinterpret_cast<const vec3&>(a[row*4]); }
+	inline float& at( int row, int col ){ return a[L::index(row,col,4)]; }
+	inline const float& at( int row, int col ) const { return a[L::index(row,col,4)]; }
 
 	// identity and transpose
-	static mat4 identity(){ return mat4(); }
-	inline mat4& setIdentity(){ _12=_13=_14=_21=_23=_24=_31=_32=_34=_41=_42=_43=0.0f;_11=_22=_33=_44=1.0f; return *this; }
-	inline mat4 transpose() const { return mat4(_11, _21, _31, _41, _12, _22, _32, _42, _13, _23, _33, _43, _14, _24, _34, _44); }
+	static tmat4 identity(){ return tmat4(); }
+	inline tmat4& setIdentity(){ _12=_13=_14=_21=_23=_24=_31=_32=_34=_41=_42=_43=0.0f;_11=_22=_33=_44=1.0f; return *this; }
+	inline tmat4 transpose() const { return tmat4(_11, _21, _31, _41, _12, _22, _32, _42, _13, _23, _33, _43, _14, _24, _34, _44); }
 
 	// addition/subtraction operators
-	inline mat4 operator+( const mat4& m ) const { mat4 r; for( int k=0; k < std::extent<decltype(a)>::value; k++ ) r[k]=a[k]+m[k]; return r; }
-	inline mat4 operator-( const mat4& m ) const { mat4 r; for( int k=0; k < std::extent<decltype(a)>::value; k++ ) r[k]=a[k]-m[k]; return r; }
-	inline mat4& operator+=( const mat4& m ){ return *this=operator+(m); }
-	inline mat4& operator-=( const mat4& m ){ return *this=operator-(m); }
+	inline tmat4 operator+( const tmat4& m ) const { tmat4 r; for( int k=0; k < std::extent<decltype(a)>::value; k++ ) r[k]=a[k]+m[k]; return r; }
+	inline tmat4 operator-( const tmat4& m ) const { tmat4 r; for( int k=0; k < std::extent<decltype(a)>::value; k++ ) r[k]=a[k]-m[k]; return r; }
+	inline tmat4& operator+=( const tmat4& m ){ return *this=operator+(m); }
+	inline tmat4& operator-=( const tmat4& m ){ return *this=operator-(m); }
 
 	// multiplication operators
-	inline mat4 operator*( float f ) const { mat4 r; for( int k=0; k < std::extent<decltype(a)>::value; k++ ) r[k]=a[k]*f; return r; }
-	inline vec4 operator*( const vec4& v ) const { return vec4(rvec4(0).dot(v), rvec4(1).dot(v), rvec4(2).dot(v), rvec4(3).dot(v)); }
-	inline mat4 operator*( const mat4& m ) const { mat4 t=m.transpose(), r; for(uint k=0;k<4;k++) r.rvec4(k)=t.operator*(rvec4(k)); return r; } // a bit tricky implementation
-	inline mat4& operator*=( const mat4& m ){ return *this=operator*(m); }
+	inline tmat4 operator*( float f ) const { tmat4 r; for( int k=0; k < std::extent<decltype(a)>::value; k++ ) r[k]=a[k]*f; return r; }
+	inline vec4 operator*( const vec4& v ) const { return vec4(_11*v.x+_12*v.y+_13*v.z+_14*v.w, _21*v.x+_22*v.y+_23*v.z+_24*v.w, _31*v.x+_32*v.y+_33*v.z+_34*v.w, _41*v.x+_42*v.y+_43*v.z+_44*v.w); }
+	inline tmat4 operator*( const tmat4& m ) const { tmat4 r; for(int i=0;i<4;i++) for(int j=0;j<4;j++) r.at(i,j)=at(i,0)*m.at(0,j)+at(i,1)*m.at(1,j)+at(i,2)*m.at(2,j)+at(i,3)*m.at(3,j); return r; }
+	inline tmat4& operator*=( const tmat4& m ){ return *this=operator*(m); }
 	
 	// determinant and inverse: see below for implementations
 	inline float determinant() const;
-	inline mat4 inverse() const; 
+	inline tmat4 inverse() const; 
 
 	// static row-major transformations
-	static mat4 translate( const vec3& v ){ return mat4().setTranslate(v); }
-	static mat4 translate( float x, float y, float z ){ return mat4().setTranslate(x,y,z); }
-	static mat4 scale( const vec3& v ){ return mat4().setScale(v); }
-	static mat4 scale( float x, float y, float z ){ return mat4().setScale(x,y,z); }
-	static mat4 rotateX( float theta ){ return mat4().setRotateX(theta); }
-	static mat4 rotateY( float theta ){ return mat4().setRotateY(theta); }
-	static mat4 rotateZ( float theta ){ return mat4().setRotateZ(theta); }
-	static mat4 rotate( const vec3& axis, float angle ){ return mat4().setRotate(axis,angle); }
-	static mat4 lookAt( const vec3& eye, const vec3& at, const vec3& up ){ return mat4().setLookAt(eye, at, up); }
-	static mat4 perspective( float fovy, float aspectRatio, float dNear, float dFar ){ return mat4().setPerspective(fovy, aspectRatio, dNear, dFar); }
+	static tmat4 translate( const vec3& v ){ return tmat4().setTranslate(v); }
+	static tmat4 translate( float x, float y, float z ){ return tmat4().setTranslate(x,y,z); }
+	static tmat4 scale( const vec3& v ){ return tmat4().setScale(v); }
+	static tmat4 scale( float x, float y, float z ){ return tmat4().setScale(x,y,z); }
+	static tmat4 rotateX( float theta ){ return tmat4().setRotateX(theta); }
+	static tmat4 rotateY( float theta ){ return tmat4().setRotateY(theta); }
+	static tmat4 rotateZ( float theta ){ return tmat4().setRotateZ(theta); }
+	static tmat4 rotate( const vec3& axis, float angle ){ return tmat4().setRotate(axis,angle); }
+	static tmat4 lookAt( const vec3& eye, const vec3& at, const vec3& up ){ return tmat4().setLookAt(eye, at, up); }
+	static tmat4 perspective( float fovy, float aspectRatio, float dNear, float dFar ){ return tmat4().setPerspective(fovy, aspectRatio, dNear, dFar); }
 
 	// row-major transformations
-	inline mat4& setTranslate( const vec3& v ){ setIdentity(); _14=v.x; _24=v.y; _34=v.z; return *this; }
-	inline mat4& setTranslate( float x,float y,float z ){ setIdentity(); _14=x; _24=y; _34=z; return *this; }
-	inline mat4& setScale( const vec3& v ){ setIdentity(); _11=v.x; _22=v.y; _33=v.z; return *this; }
-	inline mat4& setScale( float x, float y, float z ){ setIdentity(); _11=x; _22=y; _33=z; return *this; }
-	inline mat4& setRotateX( float theta ){ return setRotate(vec3(1,0,0),theta); }
-	inline mat4& setRotateY( float theta ){ return setRotate(vec3(0,1,0),theta); }
-	inline mat4& setRotateZ( float theta ){ return setRotate(vec3(0,0,1),theta); }
+	inline tmat4& setTranslate( const vec3& v ){ setIdentity(); _14=v.x; _24=v.y; _34=v.z; return *this; }
+	inline tmat4& setTranslate( float x,float y,float z ){ setIdentity(); _14=x; _24=y; _34=z; return *this; }
+	inline tmat4& setScale( const vec3& v ){ setIdentity(); _11=v.x; _22=v.y; _33=v.z; return *this; }
+	inline tmat4& setScale( float x, float y, float z ){ setIdentity(); _11=x; _22=y; _33=z; return *this; }
+	inline tmat4& setRotateX( float theta ){ return setRotate(vec3(1,0,0),theta); }
+	inline tmat4& setRotateY( float theta ){ return setRotate(vec3(0,1,0),theta); }
+	inline tmat4& setRotateZ( float theta ){ return setRotate(vec3(0,0,1),theta); }
 	
-	inline mat4& setRotate( const vec3& axis, float angle )
+	inline tmat4& setRotate( const vec3& axis, float angle )
 	{
 		float c=cos(angle), s=sin(angle), x=axis.x, y=axis.y, z=axis.z;
-		a[0] = x*x*(1-c)+c;		a[1] = x*y*(1-c)-z*s;		a[2] = x*z*(1-c)+y*s;	a[3] = 0.0f;
-		a[4] = x*y*(1-c)+z*s;	a[5] = y*y*(1-c)+c;			a[6] = y*z*(1-c)-x*s;	a[7] = 0.0f;
-		a[8] = x*z*(1-c)-y*s;	a[9] = y*z*(1-c)+x*s;		a[10] = z*z*(1-c)+c;		a[11] = 0.0f;
-		a[12] = 0;				a[13] = 0;					a[14] = 0;				a[15] = 1.0f;
+		_11 = x*x*(1-c)+c;		_12 = x*y*(1-c)-z*s;		_13 = x*z*(1-c)+y*s;	_14 = 0.0f;
+		_21 = x*y*(1-c)+z*s;	_22 = y*y*(1-c)+c;			_23 = y*z*(1-c)-x*s;	_24 = 0.0f;
+		_31 = x*z*(1-c)-y*s;	_32 = y*z*(1-c)+x*s;		_33 = z*z*(1-c)+c;		_34 = 0.0f;
+		_41 = 0;				_42 = 0;					_43 = 0;				_44 = 1.0f;
 		return *this;
 	}
 
-	mat4& setLookAt( const vec3& eye, const vec3& at, const vec3& up )
+	tmat4& setLookAt( const vec3& eye, const vec3& at, const vec3& up )
 	{
 		setIdentity();
 		
@@ -402,7 +480,7 @@ struct mat4
 		return *this;
 	};
 	
-	mat4& setPerspective( float fovy, float aspectRatio, float dNear, float dFar )
+	tmat4& setPerspective( float fovy, float aspectRatio, float dNear, float dFar )
 	{
 		setIdentity();
 		_22 = 1 / tan(fovy / 2.0f);
@@ -416,7 +494,7 @@ struct mat4
 	}
 };
 
-inline float mat4::determinant() const
+template <class L> inline float tmat4<L>::determinant() const
 {
 	return
 	_41 * _32 * _23 * _14 - _31 * _42 * _23 * _14 - _41 * _22 * _33 * _14 + _21 * _42 * _33 * _14 +
@@ -427,10 +505,10 @@ inline float mat4::determinant() const
 	_31 * _12 * _23 * _44 - _11 * _32 * _23 * _44 - _21 * _12 * _33 * _44 + _11 * _22 * _33 * _44 ;
 }
 
-inline mat4 mat4::inverse() const 
+template <class L> inline tmat4<L> tmat4<L>::inverse() const 
 {
 	float det=determinant(), s=1.0f/det; if(det==0) printf( "mat4::inverse() might be singular.\n" );
-	return mat4((_32*_43*_24 - _42*_33*_24 + _42*_23*_34 - _22*_43*_34 - _32*_23*_44 + _22*_33*_44)*s,
+	return tmat4((_32*_43*_24 - _42*_33*_24 + _42*_23*_34 - _22*_43*_34 - _32*_23*_44 + _22*_33*_44)*s,
 				(_42*_33*_14 - _32*_43*_14 - _42*_13*_34 + _12*_43*_34 + _32*_13*_44 - _12*_33*_44)*s,
 				(_22*_43*_14 - _42*_23*_14 + _42*_13*_24 - _12*_43*_24 - _22*_13*_44 + _12*_23*_44)*s,
 				(_32*_23*_14 - _22*_33*_14 - _32*_13*_24 + _12*_33*_24 + _22*_13*_34 - _12*_23*_34)*s,
@@ -451,6 +529,14 @@ inline mat4 mat4::inverse() const
 				(_21*_32*_13 - _31*_22*_13 + _31*_12*_23 - _11*_32*_23 - _21*_12*_33 + _11*_22*_33)*s );
 }
 
+//*******************************************************************
+// matrix type definitions
+#ifdef CGMATH_ROW_MAJOR
+	using mat3 = tmat3<row_major>;	using mat4 = tmat4<row_major>;
+#else
+	using mat3 = tmat3<col_major>;	using mat4 = tmat4<col_major>;
+#endif
+
 //*******************************************************************
 // scalar-vector operators
 inline vec2 operator+( float f, vec2& v ){ return v+f; }
@@ -465,12 +551,12 @@ inline vec4 operator*( float f, vec4& v ){ return v*f; }
 
 //*******************************************************************
 // vertor-matrix multiplications
-inline vec3 mul( vec3& v, mat3& m ){ return m.transpose()*v; }
-inline vec4 mul( vec4& v, mat4& m ){ return m.transpose()*v; }
-inline vec3 mul( mat3& m, vec3& v ){ return m*v; }
-inline vec4 mul( mat4& m, vec4& v ){ return m*v; }
-inline vec3 operator*( vec3& v, mat3& m ){ return m.transpose()*v; }
-inline vec4 operator*( vec4& v, mat4& m ){ return m.transpose()*v; }
+template <class L> inline vec3 mul( vec3& v, tmat3<L>& m ){ return m.transpose()*v; }
+template <class L> inline vec4 mul( vec4& v, tmat4<L>& m ){ return m.transpose()*v; }
+template <class L> inline vec3 mul( tmat3<L>& m, vec3& v ){ return m*v; }
+template <class L> inline vec4 mul( tmat4<L>& m, vec4& v ){ return m*v; }
+template <class L> inline vec3 operator*( vec3& v, tmat3<L>& m ){ return m.transpose()*v; }
+template <class L> inline vec4 operator*( vec4& v, tmat4<L>& m ){ return m.transpose()*v; }
 inline float dot( const vec2& v1, const vec2& v2){ return v1.dot(v2); }
 inline float dot( const vec3& v1, const vec3& v2){ return v1.dot(v2); }
 inline float dot( const vec4& v1, const vec4& v2){ return v1.dot(v2); }
@@ -519,3 +605,319 @@ inline float saturate( float value ){ return min(max(value,0.0f),1.0f); }
 inline vec2 saturate( const vec2& value ){ return vec2(saturate(value.x),saturate(value.y)); }
 inline vec3 saturate( const vec3& value ){ return vec3(saturate(value.x),saturate(value.y),saturate(value.z)); }
 inline vec4 saturate(const  vec4& value ){ return vec4(saturate(value.x),saturate(value.y),saturate(value.z),saturate(value.w)); }
+
+//*******************************************************************
+// fast trigonometric functions: Cody-Waite reduction to [-pi/4,pi/4]
+// (pi/2 split into four parts; exact up to 4096 quadrants) and minimax
+// polynomials of degree 7 (sin) and 8 (cos) in the reduced argument.
+// max error against double-precision sin/cos, measured over every float in the range:
+//   |x|<=2*PI:  fast_sin 1.53 ulp, fast_cos 1.56 ulp
+//   |x|<=6433:  fast_sin 2.34 ulp, fast_cos 2.32 ulp
+//   |x|>6433:   reduction loses exactness; wrap the argument beforehand
+// SIMD batch forms (SSE2, 4 per iteration) are bit-identical to the scalar ones.
+inline int _fast_trig_reduce( float x, float& r )
+{
+	float t = x*0.636619772367581343f+12582912.0f;	// 1.5*2^23: rounds to nearest even as cvtps2dq does
+	float j = t-12582912.0f;
+	r = (((x-j*1.5703125f)-j*4.837512969970703125e-4f)-j*7.54953362047672271728515625e-8f)-j*2.5633440682570896e-12f;
+	return int(j);
+}
+inline float _fast_sin_poly( float r, float r2 ){ return r+r*r2*(-1.6666654611e-1f+r2*(8.3321608736e-3f+r2*-1.9515295891e-4f)); }
+inline float _fast_cos_poly( float r2 ){ return 1.0f-0.5f*r2+r2*r2*(4.166664568298827e-2f+r2*(-1.388731625493765e-3f+r2*2.443315711809948e-5f)); }
+inline float _fast_trig_quadrant( int q, float r ){ float r2=r*r, p=(q&1)?_fast_cos_poly(r2):_fast_sin_poly(r,r2); return (q&2)?-p:p; }
+
+inline float fast_sin( float x ){ float r; int q=_fast_trig_reduce(x,r); return _fast_trig_quadrant(q,r); }
+inline float fast_cos( float x ){ float r; int q=_fast_trig_reduce(x,r); return _fast_trig_quadrant(q+1,r); }	// cos(x) = sin(x+pi/2)
+inline void fast_sincos( float x, float& s, float& c ){ float r; int q=_fast_trig_reduce(x,r); s=_fast_trig_quadrant(q,r); c=_fast_trig_quadrant(q+1,r); }
+
+#ifdef CGMATH_SSE2
+inline void _fast_sincos_ps( __m128 x, __m128* s, __m128* c )
+{
+	__m128i q = _mm_cvtps_epi32(_mm_mul_ps(x,_mm_set1_ps(0.636619772367581343f)));	// round to nearest
+	__m128 j = _mm_cvtepi32_ps(q);
+	__m128 r = _mm_sub_ps(x,_mm_mul_ps(j,_mm_set1_ps(1.5703125f)));
+	r = _mm_sub_ps(r,_mm_mul_ps(j,_mm_set1_ps(4.837512969970703125e-4f)));
+	r = _mm_sub_ps(r,_mm_mul_ps(j,_mm_set1_ps(7.54953362047672271728515625e-8f)));
+	r = _mm_sub_ps(r,_mm_mul_ps(j,_mm_set1_ps(2.5633440682570896e-12f)));
+	__m128 r2 = _mm_mul_ps(r,r);
+
+	__m128 ps = _mm_add_ps(_mm_set1_ps(8.3321608736e-3f),_mm_mul_ps(r2,_mm_set1_ps(-1.9515295891e-4f)));
+	ps = _mm_add_ps(_mm_set1_ps(-1.6666654611e-1f),_mm_mul_ps(r2,ps));
+	ps = _mm_add_ps(r,_mm_mul_ps(_mm_mul_ps(r,r2),ps));
+	__m128 pc = _mm_add_ps(_mm_set1_ps(-1.388731625493765e-3f),_mm_mul_ps(r2,_mm_set1_ps(2.443315711809948e-5f)));
+	pc = _mm_add_ps(_mm_set1_ps(4.166664568298827e-2f),_mm_mul_ps(r2,pc));
+	pc = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f),_mm_mul_ps(_mm_set1_ps(0.5f),r2)),_mm_mul_ps(_mm_mul_ps(r2,r2),pc));
+
+	// odd quadrants swap sin/cos; bit 1 of q (and of q+1 for cos) flips the sign
+	__m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2);
+	__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q,one),one));
+	__m128 ssign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q,two),30));
+	__m128 csign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q,one),two),30));
+	if(s) *s = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap,pc),_mm_andnot_ps(swap,ps)),ssign);
+	if(c) *c = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap,ps),_mm_andnot_ps(swap,pc)),csign);
+}
+#endif
+
+// batch forms: s and/or c may be nullptr in fast_sincos()
+inline void fast_sincos( const float* x, float* s, float* c, size_t n )
+{
+	size_t k=0;
+#ifdef CGMATH_SSE2
+	for( __m128 vs, vc; k+4<=n; k+=4 )
+	{
+		_fast_sincos_ps( _mm_loadu_ps(x+k), s?&vs:nullptr, c?&vc:nullptr );
+		if(s) _mm_storeu_ps(s+k,vs);
+		if(c) _mm_storeu_ps(c+k,vc);
+	}
+#endif
+	for( float ts, tc; k<n; k++ ){ fast_sincos(x[k],ts,tc); if(s) s[k]=ts; if(c) c[k]=tc; }
+}
+inline void fast_sin( const float* x, float* s, size_t n ){ fast_sincos(x,s,nullptr,n); }
+inline void fast_cos( const float* x, float* c, size_t n ){ fast_sincos(x,nullptr,c,n); }
+
+//*******************************************************************
+// bounding volumes and frustum culling
+struct aabb { vec3 lo, hi; };	// axis-aligned bounding box
+
+struct frustum
+{
+	vec4 plane[6];	// left, right, bottom, top, near, far: (n,d) with inward unit normal n; inside if dot(n,p)+d>=0
+
+	// scalar tests: summed in the order of the SSE2 batches, so both classify every object alike
+	inline bool contains( const vec3& center, float radius ) const { for( int k=0; k<6; k++ ){ const vec4& p=plane[k]; if((p.x*center.x+p.y*center.y)+(p.z*center.z+p.w)<-radius) return false; } return true; }
+	inline bool contains( const aabb& b ) const
+	{
+		vec3 c=(b.lo+b.hi)*0.5f, e=(b.hi-b.lo)*0.5f;	// outside if dot(n,c)+d < -dot(|n|,e)
+		for( int k=0; k<6; k++ ){ const vec4& p=plane[k]; if((p.x*c.x+p.y*c.y)+(p.z*c.z+p.w)+(e.x*fabs(p.x)+e.y*fabs(p.y)+e.z*fabs(p.z))<0) return false; }
+		return true;
+	}
+};
+
+// Gribb-Hartmann extraction from a view-projection matrix (GL clip space: -w<=x,y,z<=w)
+template <class L> inline frustum extract_frustum( const tmat4<L>& m )
+{
+	frustum f; vec4 r[4];
+	for( int i=0; i<4; i++ ) r[i] = vec4(m.at(i,0),m.at(i,1),m.at(i,2),m.at(i,3));
+	f.plane[0]=r[3]+r[0]; f.plane[1]=r[3]-r[0];
+	f.plane[2]=r[3]+r[1]; f.plane[3]=r[3]-r[1];
+	f.plane[4]=r[3]+r[2]; f.plane[5]=r[3]-r[2];
+	for( int k=0; k<6; k++ ){ vec4& p=f.plane[k]; float l=sqrt(p.x*p.x+p.y*p.y+p.z*p.z); if(l>0) p/=l; }
+	return f;
+}
+
+// batch culling: writes indices of visible objects to visible[] (capacity n) and returns their count.
+// spheres are (center.xyz, radius); SSE2 tests four objects per iteration with branch-free compaction.
+inline size_t cull_spheres( const frustum& f, const vec4* spheres, size_t n, uint* visible )
+{
+	size_t k=0, count=0;
+#ifdef CGMATH_SSE2
+	for( ; k+4<=n; k+=4 )
+	{
+		__m128 x=_mm_loadu_ps(&spheres[k].x), y=_mm_loadu_ps(&spheres[k+1].x), z=_mm_loadu_ps(&spheres[k+2].x), r=_mm_loadu_ps(&spheres[k+3].x);
+		_MM_TRANSPOSE4_PS(x,y,z,r);	// AoS to SoA: x, y, z, radius of four spheres
+		__m128 nr=_mm_sub_ps(_mm_setzero_ps(),r), out=_mm_setzero_ps();
+		for( int p=0; p<6; p++ )
+		{
+			const vec4& q=f.plane[p];
+			__m128 d=_mm_add_ps(_mm_add_ps(_mm_mul_ps(x,_mm_set1_ps(q.x)),_mm_mul_ps(y,_mm_set1_ps(q.y))),_mm_add_ps(_mm_mul_ps(z,_mm_set1_ps(q.z)),_mm_set1_ps(q.w)));
+			out=_mm_or_ps(out,_mm_cmplt_ps(d,nr));
+		}
+		int mask=~_mm_movemask_ps(out);
+		for( int j=0; j<4; j++ ){ visible[count]=uint(k+j); count+=(mask>>j)&1; }
+	}
+#endif
+	for( ; k<n; k++ ){ visible[count]=uint(k); count+=f.contains(vec3(spheres[k].x,spheres[k].y,spheres[k].z),spheres[k].w)?1:0; }
+	return count;
+}
+
+inline size_t cull_aabbs( const frustum& f, const aabb* boxes, size_t n, uint* visible )
+{
+	size_t k=0, count=0;
+#ifdef CGMATH_SSE2
+	for( ; k+4<=n; k+=4 )
+	{
+		const aabb* b=boxes+k;	// center/half-extent form as in frustum::contains()
+		__m128 h=_mm_set1_ps(0.5f);
+		__m128 cx=_mm_mul_ps(h,_mm_set_ps(b[3].lo.x+b[3].hi.x,b[2].lo.x+b[2].hi.x,b[1].lo.x+b[1].hi.x,b[0].lo.x+b[0].hi.x));
+		__m128 cy=_mm_mul_ps(h,_mm_set_ps(b[3].lo.y+b[3].hi.y,b[2].lo.y+b[2].hi.y,b[1].lo.y+b[1].hi.y,b[0].lo.y+b[0].hi.y));
+		__m128 cz=_mm_mul_ps(h,_mm_set_ps(b[3].lo.z+b[3].hi.z,b[2].lo.z+b[2].hi.z,b[1].lo.z+b[1].hi.z,b[0].lo.z+b[0].hi.z));
+		__m128 ex=_mm_mul_ps(h,_mm_set_ps(b[3].hi.x-b[3].lo.x,b[2].hi.x-b[2].lo.x,b[1].hi.x-b[1].lo.x,b[0].hi.x-b[0].lo.x));
+		__m128 ey=_mm_mul_ps(h,_mm_set_ps(b[3].hi.y-b[3].lo.y,b[2].hi.y-b[2].lo.y,b[1].hi.y-b[1].lo.y,b[0].hi.y-b[0].lo.y));
+		__m128 ez=_mm_mul_ps(h,_mm_set_ps(b[3].hi.z-b[3].lo.z,b[2].hi.z-b[2].lo.z,b[1].hi.z-b[1].lo.z,b[0].hi.z-b[0].lo.z));
+		__m128 out=_mm_setzero_ps();
+		for( int p=0; p<6; p++ )
+		{
+			const vec4& q=f.plane[p];
+			__m128 d=_mm_add_ps(_mm_add_ps(_mm_mul_ps(cx,_mm_set1_ps(q.x)),_mm_mul_ps(cy,_mm_set1_ps(q.y))),_mm_add_ps(_mm_mul_ps(cz,_mm_set1_ps(q.z)),_mm_set1_ps(q.w)));
+			__m128 e=_mm_add_ps(_mm_add_ps(_mm_mul_ps(ex,_mm_set1_ps(fabs(q.x))),_mm_mul_ps(ey,_mm_set1_ps(fabs(q.y)))),_mm_mul_ps(ez,_mm_set1_ps(fabs(q.z))));
+			out=_mm_or_ps(out,_mm_cmplt_ps(_mm_add_ps(d,e),_mm_setzero_ps()));
+		}
+		int mask=~_mm_movemask_ps(out);
+		for( int j=0; j<4; j++ ){ visible[count]=uint(k+j); count+=(mask>>j)&1; }
+	}
+#endif
+	for( ; k<n; k++ ){ visible[count]=uint(k); count+=f.contains(boxes[k])?1:0; }
+	return count;
+}
+
+//*******************************************************************
+// half-float and packed vertex formats; all conversions round to nearest even
+// and the packed ones decode exactly as GL unpacks normalized attributes:
+//   SNORM:  f = max(c/(2^(b-1)-1),-1)   e.g. GL_INT_2_10_10_10_REV, GL_SHORT
+//   UNORM:  f = c/(2^b-1)               e.g. GL_UNSIGNED_SHORT
+// batch forms take byte strides so they can run directly over interleaved
+// vertices (e.g., &vertex_list[0].norm with sizeof(vertex)); SSE2, 4 per iteration.
+inline float _round_even( float f ){ return (f+12582912.0f)-12582912.0f; }	// valid for |f|<2^22
+inline uint _float_bits( float f ){ uint u; memcpy(&u,&f,sizeof(u)); return u; }
+inline float _bits_float( uint u ){ float f; memcpy(&f,&u,sizeof(f)); return f; }
+
+inline ushort float_to_half( float f )
+{
+	uint u=_float_bits(f), sign=(u>>16)&0x8000; u&=0x7fffffff;
+	if(u>=(143u<<23)) return ushort(sign|(u>(255u<<23)?0x7e00:0x7c00));			// overflow to inf; NaN to qNaN
+	if(u<(113u<<23)) return ushort(sign|(_float_bits(_bits_float(u)+0.5f)-_float_bits(0.5f)));	// subnormal: align mantissa by fp addition
+	return ushort(sign|((u+(uint(15-127)<<23)+0xfff+((u>>13)&1))>>13));			// normal: rebias, round half to even
+}
+
+inline float half_to_float( ushort h )
+{
+	uint u=uint(h&0x7fff)<<13, e=u&(0x7c00u<<13);
+	u+=uint(127-15)<<23;
+	if(e==(0x7c00u<<13)) u+=uint(128-16)<<23;									// inf/NaN
+	else if(e==0) u=_float_bits(_bits_float(u+(1u<<23))-_bits_float(113u<<23));	// zero/subnormal: renormalize
+	return _bits_float(u|(uint(h&0x8000)<<16));
+}
+
+inline uint pack_snorm_1010102( const vec3& v, float w=0.0f )	// x in bits 0-9 (GL_INT_2_10_10_10_REV)
+{
+	int x=int(_round_even(clamp(v.x,-1.0f,1.0f)*511.0f)), y=int(_round_even(clamp(v.y,-1.0f,1.0f)*511.0f)), z=int(_round_even(clamp(v.z,-1.0f,1.0f)*511.0f)), a=int(_round_even(clamp(w,-1.0f,1.0f)));
+	return (uint(x)&0x3ff)|((uint(y)&0x3ff)<<10)|((uint(z)&0x3ff)<<20)|(uint(a)<<30);
+}
+inline vec4 unpack_snorm_1010102( uint p )
+{
+	int x=int(p<<22)>>22, y=int(p<<12)>>22, z=int(p<<2)>>22, w=int(p)>>30;
+	return vec4(max(x/511.0f,-1.0f),max(y/511.0f,-1.0f),max(z/511.0f,-1.0f),max(float(w),-1.0f));
+}
+
+inline uint pack_unorm16x2( const vec2& v ){ return uint(_round_even(saturate(v.x)*65535.0f))|(uint(_round_even(saturate(v.y)*65535.0f))<<16); }
+inline vec2 unpack_unorm16x2( uint p ){ return vec2((p&0xffff)/65535.0f,(p>>16)/65535.0f); }
+
+// octahedral unit-vector encoding in two SNORM16 (GL_SHORT, normalized); decode in the shader as oct_decode() does.
+// zero, infinite or NaN vectors encode (0,0,1), in the batch form as well
+inline uint oct_encode( const vec3& n )
+{
+	float l=fabs(n.x)+fabs(n.y)+fabs(n.z); if(!(l>0&&l<=FLT_MAX)) return 0;
+	float x=n.x/l, y=n.y/l;
+	if(n.z<0){ float t=(1.0f-fabs(y))*(x>=0?1.0f:-1.0f); y=(1.0f-fabs(x))*(y>=0?1.0f:-1.0f); x=t; }
+	return (uint(int(_round_even(clamp(x,-1.0f,1.0f)*32767.0f)))&0xffff)|(uint(int(_round_even(clamp(y,-1.0f,1.0f)*32767.0f)))<<16);
+}
+inline vec3 oct_decode( uint p )
+{
+	float x=max(float(short(p&0xffff))/32767.0f,-1.0f), y=max(float(short(p>>16))/32767.0f,-1.0f), z=1.0f-fabs(x)-fabs(y);
+	if(z<0){ float t=(1.0f-fabs(y))*(x>=0?1.0f:-1.0f); y=(1.0f-fabs(x))*(y>=0?1.0f:-1.0f); x=t; }
+	return vec3(x,y,z).normalize();
+}
+
+#ifdef CGMATH_SSE2
+inline __m128 _load_strided_ps( const uchar* p, size_t stride, int c ){ return _mm_set_ps(((const float*)(p+stride*3))[c],((const float*)(p+stride*2))[c],((const float*)(p+stride))[c],((const float*)p)[c]); }
+inline void _store_strided_epi32( uchar* p, size_t stride, __m128i v ){ uint u[4]; _mm_storeu_si128((__m128i*)u,v); for( int j=0; j<4; j++ ) memcpy(p+stride*j,u+j,sizeof(uint)); }
+inline __m128 _clamp_ps( __m128 v, float lo, float hi ){ return _mm_min_ps(_mm_max_ps(v,_mm_set1_ps(lo)),_mm_set1_ps(hi)); }
+inline __m128i _pack_u16_epi32( __m128i v ){ v=_mm_srai_epi32(_mm_slli_epi32(v,16),16); return _mm_packs_epi32(v,v); }	// low 16 bits of four ints to four ushorts
+#endif
+
+inline void float_to_half( const float* src, ushort* dst, size_t n )
+{
+	size_t k=0;
+#ifdef CGMATH_SSE2
+	const __m128i abs_mask=_mm_set1_epi32(0x7fffffff), f16max=_mm_set1_epi32(143<<23), f32inf=_mm_set1_epi32(255<<23), subnorm=_mm_set1_epi32(113<<23);
+	const __m128i half_bits=_mm_set1_epi32(int(_float_bits(0.5f))), bias=_mm_set1_epi32(int((uint(15-127)<<23)+0xfff)), one=_mm_set1_epi32(1);
+	for( ; k+4<=n; k+=4 )
+	{
+		__m128i u=_mm_castps_si128(_mm_loadu_ps(src+k)), a=_mm_and_si128(u,abs_mask);
+		__m128i sign=_mm_and_si128(_mm_srli_epi32(u,16),_mm_set1_epi32(0x8000));
+		__m128i special=_mm_or_si128(_mm_set1_epi32(0x7c00),_mm_and_si128(_mm_cmpgt_epi32(a,f32inf),_mm_set1_epi32(0x0200)));
+		__m128i sub=_mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(a),_mm_set1_ps(0.5f))),half_bits);
+		__m128i nrm=_mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(a,bias),_mm_and_si128(_mm_srli_epi32(a,13),one)),13);
+		__m128i is_sub=_mm_cmplt_epi32(a,subnorm), is_special=_mm_cmpgt_epi32(a,_mm_sub_epi32(f16max,one));
+		__m128i h=_mm_or_si128(_mm_and_si128(is_sub,sub),_mm_andnot_si128(is_sub,nrm));
+		h=_mm_or_si128(_mm_and_si128(is_special,special),_mm_andnot_si128(is_special,h));
+		_mm_storel_epi64((__m128i*)(dst+k),_pack_u16_epi32(_mm_or_si128(h,sign)));
+	}
+#endif
+	for( size_t j=0, r=n-k; j<r; j++ ) dst[k+j]=float_to_half(src[k+j]);	// the remainder, bounded by its count
+}
+
+inline void half_to_float( const ushort* src, float* dst, size_t n )
+{
+	size_t k=0;
+#ifdef CGMATH_SSE2
+	const __m128i exp_mask=_mm_set1_epi32(0x7c00<<13), zero=_mm_setzero_si128();
+	for( ; k+4<=n; k+=4 )
+	{
+		__m128i h=_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(src+k)),zero);
+		__m128i u=_mm_slli_epi32(_mm_and_si128(h,_mm_set1_epi32(0x7fff)),13), e=_mm_and_si128(u,exp_mask);
+		u=_mm_add_epi32(u,_mm_set1_epi32(int(127-15)<<23));
+		__m128i is_special=_mm_cmpeq_epi32(e,exp_mask), is_sub=_mm_cmpeq_epi32(e,zero);
+		__m128i sub=_mm_castps_si128(_mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(u,_mm_set1_epi32(1<<23))),_mm_castsi128_ps(_mm_set1_epi32(113<<23))));
+		u=_mm_add_epi32(u,_mm_and_si128(is_special,_mm_set1_epi32(int(128-16)<<23)));
+		u=_mm_or_si128(_mm_and_si128(is_sub,sub),_mm_andnot_si128(is_sub,u));
+		_mm_storeu_ps(dst+k,_mm_castsi128_ps(_mm_or_si128(u,_mm_slli_epi32(_mm_and_si128(h,_mm_set1_epi32(0x8000)),16))));
+	}
+#endif
+	for( ; k<n; k++ ) dst[k]=half_to_float(src[k]);
+}
+
+inline void pack_snorm_1010102( const vec3* src, uint* dst, size_t n, size_t src_stride=sizeof(vec3), size_t dst_stride=sizeof(uint) )
+{
+	const uchar* s=(const uchar*)src; uchar* d=(uchar*)dst; size_t k=0;
+#ifdef CGMATH_SSE2
+	const __m128 scale=_mm_set1_ps(511.0f); const __m128i mask=_mm_set1_epi32(0x3ff);
+	for( ; k+4<=n; k+=4, s+=src_stride*4, d+=dst_stride*4 )
+	{
+		__m128i x=_mm_cvtps_epi32(_mm_mul_ps(_clamp_ps(_load_strided_ps(s,src_stride,0),-1.0f,1.0f),scale));
+		__m128i y=_mm_cvtps_epi32(_mm_mul_ps(_clamp_ps(_load_strided_ps(s,src_stride,1),-1.0f,1.0f),scale));
+		__m128i z=_mm_cvtps_epi32(_mm_mul_ps(_clamp_ps(_load_strided_ps(s,src_stride,2),-1.0f,1.0f),scale));
+		_store_strided_epi32(d,dst_stride,_mm_or_si128(_mm_and_si128(x,mask),_mm_or_si128(_mm_slli_epi32(_mm_and_si128(y,mask),10),_mm_slli_epi32(_mm_and_si128(z,mask),20))));
+	}
+#endif
+	for( ; k<n; k++, s+=src_stride, d+=dst_stride ){ uint p=pack_snorm_1010102(*(const vec3*)s); memcpy(d,&p,sizeof(p)); }
+}
+
+inline void pack_unorm16x2( const vec2* src, uint* dst, size_t n, size_t src_stride=sizeof(vec2), size_t dst_stride=sizeof(uint) )
+{
+	const uchar* s=(const uchar*)src; uchar* d=(uchar*)dst; size_t k=0;
+#ifdef CGMATH_SSE2
+	const __m128 scale=_mm_set1_ps(65535.0f);
+	for( ; k+4<=n; k+=4, s+=src_stride*4, d+=dst_stride*4 )
+	{
+		__m128i x=_mm_cvtps_epi32(_mm_mul_ps(_clamp_ps(_load_strided_ps(s,src_stride,0),0.0f,1.0f),scale));
+		__m128i y=_mm_cvtps_epi32(_mm_mul_ps(_clamp_ps(_load_strided_ps(s,src_stride,1),0.0f,1.0f),scale));
+		_store_strided_epi32(d,dst_stride,_mm_or_si128(x,_mm_slli_epi32(y,16)));
+	}
+#endif
+	for( ; k<n; k++, s+=src_stride, d+=dst_stride ){ uint p=pack_unorm16x2(*(const vec2*)s); memcpy(d,&p,sizeof(p)); }
+}
+
+inline void oct_encode( const vec3* src, uint* dst, size_t n, size_t src_stride=sizeof(vec3), size_t dst_stride=sizeof(uint) )
+{
+	const uchar* s=(const uchar*)src; uchar* d=(uchar*)dst; size_t k=0;
+#ifdef CGMATH_SSE2
+	const __m128 sign_mask=_mm_set1_ps(-0.0f), one=_mm_set1_ps(1.0f), scale=_mm_set1_ps(32767.0f);
+	for( ; k+4<=n; k+=4, s+=src_stride*4, d+=dst_stride*4 )
+	{
+		__m128 x=_load_strided_ps(s,src_stride,0), y=_load_strided_ps(s,src_stride,1), z=_load_strided_ps(s,src_stride,2);
+		__m128 l=_mm_add_ps(_mm_add_ps(_mm_andnot_ps(sign_mask,x),_mm_andnot_ps(sign_mask,y)),_mm_andnot_ps(sign_mask,z));
+		x=_mm_div_ps(x,l); y=_mm_div_ps(y,l);
+		__m128 sx=_mm_or_ps(one,_mm_and_ps(_mm_cmplt_ps(x,_mm_setzero_ps()),sign_mask));	// x>=0?1:-1
+		__m128 sy=_mm_or_ps(one,_mm_and_ps(_mm_cmplt_ps(y,_mm_setzero_ps()),sign_mask));
+		__m128 fx=_mm_mul_ps(_mm_sub_ps(one,_mm_andnot_ps(sign_mask,y)),sx), fy=_mm_mul_ps(_mm_sub_ps(one,_mm_andnot_ps(sign_mask,x)),sy);
+		__m128 fold=_mm_cmplt_ps(z,_mm_setzero_ps());
+		x=_mm_or_ps(_mm_and_ps(fold,fx),_mm_andnot_ps(fold,x)); y=_mm_or_ps(_mm_and_ps(fold,fy),_mm_andnot_ps(fold,y));
+		__m128 valid=_mm_and_ps(_mm_cmpgt_ps(l,_mm_setzero_ps()),_mm_cmple_ps(l,_mm_set1_ps(FLT_MAX)));	// (0,0,1) otherwise
+		x=_mm_and_ps(valid,x); y=_mm_and_ps(valid,y);
+		__m128i ix=_mm_cvtps_epi32(_mm_mul_ps(_clamp_ps(x,-1.0f,1.0f),scale)), iy=_mm_cvtps_epi32(_mm_mul_ps(_clamp_ps(y,-1.0f,1.0f),scale));
+		_store_strided_epi32(d,dst_stride,_mm_or_si128(_mm_and_si128(ix,_mm_set1_epi32(0xffff)),_mm_slli_epi32(iy,16)));
+	}
+#endif
+	for( ; k<n; k++, s+=src_stride, d+=dst_stride ){ uint p=oct_encode(*(const vec3*)s); memcpy(d,&p,sizeof(p)); }
+}
@@ -3,9 +3,48 @@
 #define __CGUT_H__
 
 // minimum standard headers
+#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+// threading for asynchronous loading; shield the headers from cgmath's min/max macros
+#pragma push_macro("min")
+#pragma push_macro("max")
+#undef min
+#undef max
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#pragma pop_macro("max")
+#pragma pop_macro("min")
+
+// file mapping and process memory statistics
+#ifdef _WIN32
+	#include <direct.h>
+	#include <sys/types.h>
+	#include <sys/stat.h>
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+	#include <psapi.h>
+	#pragma comment( lib, "psapi.lib" )
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/resource.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+	#ifdef __linux__
+		#include <sys/inotify.h>
+	#endif
+#endif
+
 // enforce not to use /MD or /MDd flag
 #ifdef _DLL
 	#error Use /MT (or /MTd for DEBUG) at Configuration -> C/C++ -> Code Generation -> Run-time Library
@@ -30,6 +69,16 @@ struct mem_t
 	size_t	size = 0;
 };
 
+struct mmap_t // read-only memory-mapped file
+{
+	const char*	ptr = nullptr;
+	size_t		size = 0;
+#ifdef _WIN32
+	HANDLE		file = INVALID_HANDLE_VALUE;
+	HANDLE		mapping = nullptr;
+#endif
+};
+
 struct vertex // will be used for all the course examples
 {
     vec3 pos;	// position
@@ -37,6 +86,13 @@ struct vertex // will be used for all the course examples
     vec2 tex;	// texture coordinate; ignore this for the moment
 };
 
+struct packed_vertex // compressed layout for upload: 20 bytes instead of 32
+{
+	vec3 pos;	// position
+	uint norm;	// normal in SNORM 10:10:10:2 (GL_INT_2_10_10_10_REV)
+	uint tex;	// texture coordinate in UNORM16x2 (GL_UNSIGNED_SHORT)
+};
+
 struct mesh
 {
 	std::vector<vertex>	vertex_list;
@@ -44,6 +100,47 @@ struct mesh
 	GLuint				vertex_buffer = 0;
 	GLuint				index_buffer = 0;
 	GLuint				texture = 0;
+	size_t				vertex_count = 0;	// valid without host copies
+	size_t				index_count = 0;
+	GLenum				index_type = GL_UNSIGNED_INT;
+	bool				packed = false;		// vertex_buffer holds packed_vertex
+	aabb				box = { vec3(0), vec3(0) };
+	vec4				sphere = vec4(0);	// bounding sphere: center.xyz, radius
+	vertex*				vertices = nullptr;	// host geometry placed in a cg_mesh_pool arena (instead of vertex_list/index_list)
+	uint*				indices = nullptr;
+	bool				pooled = false;		// memory is owned by a cg_mesh_pool and returns on its release()
+};
+
+//*******************************************************************
+// mesh container: [mesh_header][vertex section][index section], sections aligned by CG_MESH_ALIGN
+#define CG_MESH_MAGIC	0x48534d43u	// "CMSH"
+#define CG_MESH_VERSION	2
+#define CG_MESH_ALIGN	64
+
+enum cg_vertex_layout { CG_LAYOUT_VERTEX=0, CG_LAYOUT_PACKED_VERTEX=1 };
+enum cg_mesh_codec { CG_CODEC_NONE=0, CG_CODEC_QLZ=1 };	// QLZ: quantized, delta/zigzag-filtered streams + LZ
+
+struct mesh_header
+{
+	uint		magic;
+	uint		version;
+	uint		header_size;		// sizeof(mesh_header) of the writer
+	uint		vertex_layout;		// cg_vertex_layout
+	uint		vertex_stride;		// bytes per vertex
+	uint		index_width;		// bytes per index: 2, 4, or 0 without indices
+	uint		codec;				// cg_mesh_codec; layout and widths describe the decoded data
+	uint		reserved;
+	uint64_t	vertex_count;
+	uint64_t	index_count;
+	uint64_t	vertex_offset;		// from the beginning of the file
+	uint64_t	index_offset;
+	uint64_t	vertex_bytes;		// stored section sizes
+	uint64_t	index_bytes;
+	uint64_t	file_size;
+	aabb		box;
+	vec4		sphere;				// center.xyz, radius
+	uint		data_checksum;		// FNV-1a of the vertex and index sections
+	uint		header_checksum;	// FNV-1a of the preceding header bytes
 };
 
 //*******************************************************************
@@ -61,18 +158,91 @@ inline mem_t cg_read_binary( const char* file_path )
 	return m;
 }
 
+inline void cg_unmap_binary( mmap_t& m )
+{
+#ifdef _WIN32
+	if(m.ptr) UnmapViewOfFile( m.ptr );
+	if(m.mapping) CloseHandle( m.mapping );
+	if(m.file!=INVALID_HANDLE_VALUE) CloseHandle( m.file );
+#else
+	if(m.ptr) munmap( (void*) m.ptr, m.size );
+#endif
+	m = mmap_t();
+}
+
+inline mmap_t cg_map_binary( const char* file_path )
+{
+	mmap_t m;
+#ifdef _WIN32
+	m.file = CreateFileA( file_path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+	if(m.file==INVALID_HANDLE_VALUE){ printf( "[error] Unable to open %s\n", file_path ); return mmap_t(); }
+	LARGE_INTEGER size; GetFileSizeEx( m.file, &size ); m.size = size_t(size.QuadPart);
+	if(m.size) m.mapping = CreateFileMappingA( m.file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	if(m.mapping) m.ptr = (const char*) MapViewOfFile( m.mapping, FILE_MAP_READ, 0, 0, 0 );
+#else
+	int fd = open( file_path, O_RDONLY ); if(fd<0){ printf( "[error] Unable to open %s\n", file_path ); return mmap_t(); }
+	struct stat st; fstat( fd, &st ); m.size = size_t(st.st_size);
+	void* p = m.size ? mmap( nullptr, m.size, PROT_READ, MAP_PRIVATE, fd, 0 ) : MAP_FAILED;
+	if(p!=MAP_FAILED){ m.ptr = (const char*) p; madvise( p, m.size, MADV_SEQUENTIAL ); }
+	close(fd);
+#endif
+	if(m.size&&!m.ptr){ printf( "[error] Unable to map %s\n", file_path ); cg_unmap_binary(m); }
+	return m;
+}
+
+inline size_t cg_peak_rss() // peak resident set size in bytes
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS pmc; return GetProcessMemoryInfo( GetCurrentProcess(), &pmc, sizeof(pmc) ) ? pmc.PeakWorkingSetSize : 0;
+#else
+	struct rusage ru; getrusage( RUSAGE_SELF, &ru );
+	#ifdef __APPLE__
+		return size_t(ru.ru_maxrss);		// bytes on macOS
+	#else
+		return size_t(ru.ru_maxrss)*1024;	// kilobytes on Linux
+	#endif
+#endif
+}
+
+inline uint cg_fnv1a( const void* data, size_t size, uint h=2166136261u )
+{
+	for( const uchar *p=(const uchar*)data, *e=p+size; p<e; p++ ) h=(h^*p)*16777619u;
+	return h;
+}
+
+inline std::vector<packed_vertex> cg_pack_vertices( const std::vector<vertex>& vertices )
+{
+	std::vector<packed_vertex> p(vertices.size()); if(p.empty()) return p;
+	for( size_t k=0, kn=p.size(); k<kn; k++ ) p[k].pos = vertices[k].pos;
+	pack_snorm_1010102( &vertices[0].norm, &p[0].norm, p.size(), sizeof(vertex), sizeof(packed_vertex) );
+	pack_unorm16x2( &vertices[0].tex, &p[0].tex, p.size(), sizeof(vertex), sizeof(packed_vertex) );
+	return p;
+}
+
 inline char* cg_read_shader( const char* file_path )
 {
+#ifdef _WIN32
 	// get the full path of shader file
 	char module_file_path[_MAX_PATH]; GetModuleFileNameA( 0, module_file_path, _MAX_PATH );
 	char drive[_MAX_DRIVE], dir[_MAX_DIR], fname[_MAX_FNAME], ext[_MAX_EXT];
 	_splitpath_s( module_file_path, drive,_MAX_DRIVE,dir,_MAX_DIR,fname,_MAX_FNAME,ext,_MAX_EXT);
 	char shader_file_path[_MAX_PATH]; sprintf_s( shader_file_path, "%s%s%s", drive, dir, file_path );
+#endif
 	
 	// get the full path of a shader file
 	return cg_read_binary( file_path ).ptr;
 }
 
+// inserts preprocessor definitions (e.g., "#define A\n#define B 2\n") right after the #version line
+inline std::string cg_insert_defines( const char* source, const char* defines )
+{
+	std::string s(source?source:""); if(!defines||!*defines) return s;
+	size_t v = s.find("#version"), eol = v==std::string::npos ? v : s.find('\n',v);
+	size_t at = v==std::string::npos ? 0 : eol==std::string::npos ? s.size() : eol+1;
+	if(at==s.size()&&at&&s[at-1]!='\n'){ s+='\n'; at++; }
+	return s.insert( at, defines );
+}
+
 inline bool cg_validate_shader( GLuint shaderID, const char* shaderName )
 {
 	const int MAX_LOG_LENGTH=4096;
@@ -125,7 +295,9 @@ inline GLFWwindow* cg_create_window( const char* name, int width, int height, bo
 	glfwWindowHint( GLFW_VISIBLE, GL_FALSE );
 
 	// create a windowed mode window and its OpenGL context
-	GLFWwindow* win = glfwCreateWindow( width, height, name, nullptr, nullptr ); if(!win){ printf( "Failed to create GLFW window.\n" ); glfwTerminate(); return nullptr; }
+	GLFWwindow* win = glfwCreateWindow( width, height, name, nullptr, nullptr );
+	glfwWindowHint( GLFW_VISIBLE, GL_TRUE );	// back to GLFW's default: hints are global and cannot be queried
+	if(!win){ printf( "Failed to create GLFW window.\n" ); glfwTerminate(); return nullptr; }
 
 	// get the screen size and locate the window in the center
 	const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
@@ -173,16 +345,20 @@ inline bool cg_init_extensions( GLFWwindow* window )
 	VALIDIDATE_GLAD_EXT( vertex_shader );			// functions related to vertex shaders
 	VALIDIDATE_GLAD_EXT( fragment_shader );			// functions related to fragment shaders
 	VALIDIDATE_GLAD_EXT( shader_objects );			// functions related to program and shaders
+
+	// let the driver use as many compiler threads as it likes for cg_async_program
+	if(GLAD_GL_ARB_parallel_shader_compile) glMaxShaderCompilerThreadsARB( 0xffffffff );
 #endif
 
 	return true;
 }
 
-inline GLuint cg_create_program_from_string( const char* vertex_shader_source, const char* fragment_shader_source )
+inline GLuint cg_create_program_from_string( const char* vertex_shader_source, const char* fragment_shader_source, bool retrievable=false )
 {
 	// create a program before linking shaders
 	GLuint program = glCreateProgram();
 	glUseProgram( program );
+	if(retrievable&&glProgramParameteri) glProgramParameteri( program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
 
 	// compile shader sources
 	GLuint vertex_shader = glCreateShader( GL_VERTEX_SHADER );
@@ -203,55 +379,2044 @@ inline GLuint cg_create_program_from_string( const char* vertex_shader_source, c
 	glLinkProgram( program );
 	if(!cg_validate_program( program, "program" )){ printf( "Unable to link program\n" ); return 0; }
 
+	// shaders are no longer needed once linked
+	glDetachShader( program, vertex_shader ); glDeleteShader( vertex_shader );
+	glDetachShader( program, fragment_shader ); glDeleteShader( fragment_shader );
+
 	return program;
 }
 
-inline GLuint cg_create_program( const char* vert_path, const char* frag_path )
+//*******************************************************************
+// non-blocking program creation: compile and link are issued at once, and poll() queries status only
+// after the driver reports completion (ARB_parallel_shader_compile) or, without it, a frame later
+struct cg_async_program
 {
-	const char* vertex_shader_source = cg_read_shader( vert_path ); if(vertex_shader_source==NULL) return 0;
-	const char* fragment_shader_source = cg_read_shader( frag_path ); if(fragment_shader_source==NULL) return 0;
-	
-	// try to create a program
-	GLuint program = cg_create_program_from_string( vertex_shader_source, fragment_shader_source );
+	GLuint	program = 0;
+	GLuint	shader[2] = { 0, 0 };
+	int		polls = 0;
+
+	bool pending() const { return program!=0; }
+	void start( const char* vertex_shader_source, const char* fragment_shader_source ){ compile( vertex_shader_source, fragment_shader_source ); link(); }
+	void compile( const char* vertex_shader_source, const char* fragment_shader_source )
+	{
+		cancel();
+		const char* source[2] = { vertex_shader_source, fragment_shader_source };
+		GLenum type[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+		program = glCreateProgram();
+		for( int k=0; k<2; k++ )
+		{
+			shader[k] = glCreateShader( type[k] );
+			GLint length = GLint(strlen(source[k]));
+			glShaderSource( shader[k], 1, &source[k], &length );
+			glCompileShader( shader[k] );
+			glAttachShader( program, shader[k] );
+		}
+		polls = 0;
+	}
+	void link(){ if(program) glLinkProgram( program ); }
+	int poll() // 0: in progress, 1: linked (take program), -1: failed
+	{
+		if(!program) return -1;
+		polls++;
+		if(GLAD_GL_ARB_parallel_shader_compile){ GLint done=GL_FALSE; glGetProgramiv( program, GL_COMPLETION_STATUS_ARB, &done ); if(!done) return 0; }
+		else if(polls<2) return 0;	// give a threaded driver one frame before the blocking query
+		return finish();
+	}
+	int finish() // blocking status queries: 1: linked (take program), -1: failed
+	{
+		if(!program) return -1;
+
+		// validation deletes failed shaders and programs
+		bool b0 = cg_validate_shader( shader[0], "vertex_shader" ); if(!b0) shader[0]=0;
+		bool b1 = cg_validate_shader( shader[1], "fragment_shader" ); if(!b1) shader[1]=0;
+		bool b = b0&&b1; if(b&&!cg_validate_program( program, "program" )){ program=0; b=false; }
+		for( GLuint& s : shader ) if(s){ if(program) glDetachShader( program, s ); glDeleteShader(s); s=0; }
+		if(!b){ if(program) glDeleteProgram(program); program=0; return -1; }
+		return 1;
+	}
+	GLuint take(){ GLuint p=program; program=0; return p; }
+	void cancel()
+	{
+		for( GLuint& s : shader ) if(s){ glDeleteShader(s); s=0; }
+		if(program){ glDeleteProgram(program); program=0; }
+	}
+};
+
+// batch creation: every compile is submitted, then every link, and status is queried only afterwards,
+// so drivers with threaded compilers overlap the work; failed entries are 0
+inline std::vector<GLuint> cg_create_programs_from_strings( const std::vector<std::pair<const char*,const char*>>& sources )
+{
+	std::vector<cg_async_program> batch( sources.size() );
+	for( size_t k=0; k<sources.size(); k++ ) batch[k].compile( sources[k].first, sources[k].second );
+	for( auto& p : batch ) p.link();
+
+	std::vector<GLuint> programs( sources.size(), 0 );
+	for( size_t k=0; k<batch.size(); k++ ) if(batch[k].finish()>0) programs[k] = batch[k].take();
+	return programs;
+}
+
+//*******************************************************************
+// file watcher: inotify on the parent directories on Linux (editors often replace files by rename),
+// throttled modification-time polling elsewhere
+struct cg_file_watcher
+{
+	std::vector<std::string>	paths;
+#ifdef __linux__
+	int							fd = -1;
+	std::vector<int>			wd;		// per path, watch of its directory
+#else
+	std::vector<time_t>			mtime;
+	double						last_poll = 0;
+#endif
+
+	~cg_file_watcher()
+	{
+#ifdef __linux__
+		if(fd>=0) close(fd);
+#endif
+	}
+
+	static time_t file_time( const char* path ){ struct stat st; return stat(path,&st)==0 ? st.st_mtime : 0; }
+
+	bool add( const char* path )
+	{
+		paths.push_back(path);
+#ifdef __linux__
+		if(fd<0&&(fd=inotify_init1(IN_NONBLOCK))<0){ printf( "[error] cg_file_watcher: inotify unavailable\n" ); return false; }
+		std::string dir = paths.back(); size_t slash = dir.find_last_of('/');
+		dir = slash==std::string::npos ? "." : slash==0 ? "/" : dir.substr(0,slash);
+		wd.push_back( inotify_add_watch( fd, dir.c_str(), IN_CLOSE_WRITE|IN_MOVED_TO|IN_CREATE ) );
+		if(wd.back()<0){ printf( "[error] cg_file_watcher: unable to watch %s\n", dir.c_str() ); return false; }
+#else
+		mtime.push_back( file_time(path) );
+#endif
+		return true;
+	}
+
+	bool changed() // non-blocking; true if any watched file was written since the last call
+	{
+		bool b = false;
+#ifdef __linux__
+		alignas(inotify_event) char buffer[4096];
+		for( ssize_t n; fd>=0&&(n=read(fd,buffer,sizeof(buffer)))>0; )
+		{
+			for( char* p=buffer; p<buffer+n; p+=sizeof(inotify_event)+((inotify_event*)p)->len )
+			{
+				const inotify_event* e = (const inotify_event*) p; if(!e->len) continue;
+				for( size_t k=0; k<paths.size(); k++ )
+				{
+					const char* name = strrchr(paths[k].c_str(),'/'); name = name ? name+1 : paths[k].c_str();
+					if(wd[k]==e->wd&&strcmp(name,e->name)==0) b = true;
+				}
+			}
+		}
+#else
+		double t = glfwGetTime(); if(t-last_poll<0.25) return false; last_poll = t;
+		for( size_t k=0; k<paths.size(); k++ ){ time_t m=file_time(paths[k].c_str()); if(m!=mtime[k]){ mtime[k]=m; b=true; } }
+#endif
+		return b;
+	}
+};
+
+//*******************************************************************
+// program binary cache: <cache_dir>/<key>.pbin, keyed by the sources and the driver strings
+struct program_binary_header
+{
+	uint	magic;		// "CGPB"
+	uint	key[2];		// repeated from the file name to catch renamed files
+	GLenum	format;
+	uint	length;
+};
+
+inline bool cg_program_binary_supported()
+{
+	if(!(GLAD_GL_VERSION_4_1||GLAD_GL_ARB_get_program_binary)||!glGetProgramBinary||!glProgramBinary) return false;
+	GLint formats=0; glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &formats ); return formats>0;
+}
+
+inline void cg_program_binary_key( const char* vertex_shader_source, const char* fragment_shader_source, uint key[2] )
+{
+	const char* text[] = { vertex_shader_source, fragment_shader_source, (const char*) glGetString(GL_VENDOR), (const char*) glGetString(GL_RENDERER), (const char*) glGetString(GL_VERSION) };
+	key[0]=2166136261u; key[1]=0x6b43a9b5u;	// two FNV-1a streams with different bases
+	for( const char* t : text ){ if(!t) t=""; size_t n=strlen(t)+1; key[0]=cg_fnv1a(t,n,key[0]); key[1]=cg_fnv1a(t,n,key[1]); }
+}
+
+inline GLuint cg_load_program_binary( const char* path, const uint key[2] )
+{
+	FILE* fp = fopen( path, "rb" ); if(fp==nullptr) return 0;	// plain miss
+	program_binary_header h; std::vector<char> binary;
+	bool b = fread(&h,sizeof(h),1,fp)==1&&h.magic==0x42504743u&&h.key[0]==key[0]&&h.key[1]==key[1]&&h.length>0&&h.length<(1u<<28);
+	if(b){ binary.resize(h.length); b = fread(&binary[0],h.length,1,fp)==1; }
+	fclose(fp); if(!b) return 0;
 
-	// deallocate string
-	free((void*)vertex_shader_source);
-	free((void*)fragment_shader_source);
+	// drivers reject binaries after updates or for other hardware: report and fall back
+	GLuint program = glCreateProgram();
+	glProgramBinary( program, h.format, &binary[0], GLsizei(h.length) );
+	GLint status=0; glGetProgramiv( program, GL_LINK_STATUS, &status );
+	if(!status){ printf( "> %s was rejected by the driver; recompiling\n", path ); glDeleteProgram(program); return 0; }
+	return program;
+}
+
+inline void cg_save_program_binary( const char* path, const uint key[2], GLuint program )
+{
+	GLint length=0; glGetProgramiv( program, GL_PROGRAM_BINARY_LENGTH, &length ); if(length<=0) return;
+	program_binary_header h = { 0x42504743u, { key[0], key[1] }, 0, 0 };
+	std::vector<char> binary(length); GLsizei written=0;
+	glGetProgramBinary( program, length, &written, &h.format, &binary[0] ); if(written<=0) return;
+	h.length = uint(written);
+	FILE* fp = fopen( path, "wb" ); if(fp==nullptr) return;
+	bool b = fwrite(&h,sizeof(h),1,fp)==1&&fwrite(&binary[0],h.length,1,fp)==1;
+	fclose(fp);
+	if(!b) remove(path);
+}
+
+// cache_dir enables the program binary cache; a hit skips compilation and linking.
+// defines are inserted after the #version line of both shaders (see cg_insert_defines)
+inline GLuint cg_create_program( const char* vert_path, const char* frag_path, const char* cache_dir=nullptr, const char* defines=nullptr )
+{
+	double t0 = glfwGetTime();
+	char* vert_file = cg_read_shader( vert_path ); if(vert_file==NULL) return 0;
+	char* frag_file = cg_read_shader( frag_path ); if(frag_file==NULL){ free(vert_file); return 0; }
+	std::string vert_source = cg_insert_defines( vert_file, defines ), frag_source = cg_insert_defines( frag_file, defines );
+	free(vert_file); free(frag_file);
+	const char* vertex_shader_source = vert_source.c_str();
+	const char* fragment_shader_source = frag_source.c_str();
+
+	// look up the binary cache
+	GLuint program = 0; std::string cache_path; uint key[2];
+	bool cache = cache_dir&&cg_program_binary_supported();
+	if(cache)
+	{
+		cg_program_binary_key( vertex_shader_source, fragment_shader_source, key );
+		char name[32]; snprintf( name, sizeof(name), "/%08x%08x.pbin", key[0], key[1] );
+		cache_path = std::string(cache_dir)+name;
+		program = cg_load_program_binary( cache_path.c_str(), key );
+	}
+	bool hit = program!=0;
+
+	// try to create a program; store its binary on a miss
+	if(!hit) program = cg_create_program_from_string( vertex_shader_source, fragment_shader_source, cache );
+	if(!hit&&program&&cache)
+	{
+#ifdef _WIN32
+		_mkdir( cache_dir );
+#else
+		mkdir( cache_dir, 0755 );
+#endif
+		cg_save_program_binary( cache_path.c_str(), key, program );
+	}
+	if(program&&cache) printf( "> program %s + %s: binary cache %s in %.1f ms\n", vert_path, frag_path, hit?"hit":"miss", (glfwGetTime()-t0)*1000.0 );
 	return program;
 }
 
 //*******************************************************************
-inline mesh* cg_load_mesh( const char* vert_binary_path, const char* index_binary_path )
+// shader permutations: #define variants of one vertex/fragment pair, keyed by a small integer (e.g., a bit
+// or a field per feature), so a mode switch selects another program instead of a uniform branch in every
+// invocation. get() compiles a variant on first use through cg_create_program, so variants share the
+// program binary cache; precompile() builds a list of variants ahead of time (e.g., at startup)
+struct cg_shader_permutations
+{
+	const char*				vert_path = nullptr;
+	const char*				frag_path = nullptr;
+	const char*				cache_dir = nullptr;
+	std::string				base_defines;					// common to every variant
+	std::string				(*defines_of)(uint key) = nullptr;	// variant defines of a key
+	void					(*on_create)(GLuint program) = nullptr;	// e.g., binds uniform blocks of a new variant
+	std::map<uint,GLuint>	programs;						// key -> program; 0 marks a failed variant
+	size_t					compiles = 0;					// variants created, including binary cache hits
+
+	~cg_shader_permutations(){ clear(); }
+
+	void init( const char* vert, const char* frag, const char* cache=nullptr, const char* defines=nullptr, std::string (*defines_fn)(uint)=nullptr )
+	{
+		clear(); vert_path=vert; frag_path=frag; cache_dir=cache; base_defines=defines?defines:""; defines_of=defines_fn;
+	}
+
+	std::string defines( uint key ) const { return base_defines+(defines_of?defines_of(key):std::string()); }
+
+	// 0 if the variant fails to compile; failures are remembered until reset()/clear()
+	GLuint get( uint key )
+	{
+		auto it = programs.find(key); if(it!=programs.end()) return it->second;
+		GLuint program = cg_create_program( vert_path, frag_path, cache_dir, defines(key).c_str() );
+		if(program){ compiles++; if(on_create) on_create(program); }
+		programs[key] = program;
+		return program;
+	}
+
+	void precompile( const std::vector<uint>& keys ){ for( uint key : keys ) get(key); }
+
+	// the sources changed: drop every variant and adopt a replacement for key (e.g., from a background
+	// recompilation); other variants are recompiled on their next use
+	void reset( uint key, GLuint program ){ clear(); if(program){ programs[key]=program; if(on_create) on_create(program); } }
+
+	void clear(){ for( auto& e : programs ) if(e.second) glDeleteProgram(e.second); programs.clear(); }
+};
+
+//*******************************************************************
+// matrix uniforms: column-major matrices pass to GL untouched (transpose=GL_FALSE)
+template <class L> inline void cg_set_uniform_matrix( GLint loc, const tmat3<L>& m ){ glUniformMatrix3fv( loc, 1, L::transposed?GL_TRUE:GL_FALSE, m ); }
+template <class L> inline void cg_set_uniform_matrix( GLint loc, const tmat4<L>& m ){ glUniformMatrix4fv( loc, 1, L::transposed?GL_TRUE:GL_FALSE, m ); }
+
+//*******************************************************************
+// uniform reflection: active uniforms are enumerated once after linking, and the typed setters compare
+// against a shadow copy so that only changed values reach GL; the program must be current when setting
+struct cg_uniforms
+{
+	struct entry { std::string name; GLint location=-1; GLenum type=0; GLint size=0; bool valid=false; float shadow[17]; };
+	GLuint				program = 0;
+	std::vector<entry>	entries;
+	size_t				gl_calls = 0;	// glUniform* calls issued
+
+	// call again whenever the program is relinked or replaced; shadow copies start invalid
+	void reflect( GLuint prog )
+	{
+		program = prog; entries.clear(); if(!prog) return;
+		GLint count=0, max_length=0;
+		glGetProgramiv( prog, GL_ACTIVE_UNIFORMS, &count );
+		glGetProgramiv( prog, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length );
+		std::vector<char> name( size_t(max_length>0?max_length:1)+1, 0 );
+		for( GLint k=0; k<count; k++ )
+		{
+			entry e; GLsizei length=0;
+			glGetActiveUniform( prog, GLuint(k), GLsizei(name.size()), &length, &e.size, &e.type, &name[0] );
+			e.name.assign( &name[0], size_t(length) );
+			if(e.name.size()>3&&e.name.compare(e.name.size()-3,3,"[0]")==0) e.name.resize(e.name.size()-3);
+			e.location = glGetUniformLocation( prog, e.name.c_str() );
+			if(e.location>=0) entries.push_back(e);	// members of uniform blocks have no location
+		}
+	}
+
+	entry* find( const char* name ){ for( auto& e : entries ) if(e.name==name) return &e; return nullptr; }
+
+	// true if value differs from the shadow copy, which is then updated
+	bool changed( entry* e, const void* value, size_t size )
+	{
+		if(!e||(e->valid&&memcmp(e->shadow,value,size)==0)) return false;
+		memcpy( e->shadow, value, size ); e->valid = true; gl_calls++;
+		return true;
+	}
+
+	void set( const char* name, int v ){ entry* e=find(name); if(changed(e,&v,sizeof(v))) glUniform1i( e->location, v ); }
+	void set( const char* name, float v ){ entry* e=find(name); if(changed(e,&v,sizeof(v))) glUniform1f( e->location, v ); }
+	void set( const char* name, const vec2& v ){ entry* e=find(name); if(changed(e,&v,sizeof(v))) glUniform2fv( e->location, 1, &v.x ); }
+	void set( const char* name, const vec3& v ){ entry* e=find(name); if(changed(e,&v,sizeof(v))) glUniform3fv( e->location, 1, &v.x ); }
+	void set( const char* name, const vec4& v ){ entry* e=find(name); if(changed(e,&v,sizeof(v))) glUniform4fv( e->location, 1, &v.x ); }
+	template <class L> void set( const char* name, const tmat4<L>& m ) // the layout is part of the shadow
+	{
+		float s[17]; memcpy( s, (const float*) m, sizeof(float)*16 ); s[16] = L::transposed ? 1.0f : 0.0f;
+		entry* e=find(name); if(changed(e,s,sizeof(s))) cg_set_uniform_matrix( e->location, m );
+	}
+};
+
+//*******************************************************************
+// vertex formats and vertex array objects: a format describes the attributes of a vertex layout once,
+// and cg_vao_cache bakes it with the buffers into a VAO per (program, vertex buffer, index buffer, format).
+// VAOs are per context and refer to buffer objects, so entries must be invalidated when a buffer or
+// program is deleted; buffers refilled in place (cg_buffer) keep their VAOs valid
+struct cg_vertex_attrib { const char* name; GLint size; GLenum type; GLboolean normalized; size_t offset; };
+struct cg_vertex_format { GLsizei stride; std::vector<cg_vertex_attrib> attribs; };
+
+inline const cg_vertex_format& cg_vertex_format_of( bool packed ) // vertex or packed_vertex
+{
+	static const cg_vertex_format f[2] =
+	{
+		{ GLsizei(sizeof(vertex)), { {"position",3,GL_FLOAT,GL_FALSE,0}, {"normal",3,GL_FLOAT,GL_FALSE,sizeof(vec3)}, {"texcoord",2,GL_FLOAT,GL_FALSE,sizeof(vec3)*2} } },
+		{ GLsizei(sizeof(packed_vertex)), { {"position",3,GL_FLOAT,GL_FALSE,0}, {"normal",4,GL_INT_2_10_10_10_REV,GL_TRUE,sizeof(vec3)}, {"texcoord",2,GL_UNSIGNED_SHORT,GL_TRUE,sizeof(vec3)+sizeof(uint)} } }
+	};
+	return f[packed?1:0];
+}
+
+// sets up the attributes of format from buffer for program (into the bound VAO, if any)
+inline void cg_bind_vertex_format( GLuint program, GLuint buffer, const cg_vertex_format& format )
+{
+	glBindBuffer( GL_ARRAY_BUFFER, buffer );
+	for( auto& a : format.attribs )
+	{
+		GLint loc = glGetAttribLocation( program, a.name ); if(loc<0) continue;
+		glEnableVertexAttribArray( GLuint(loc) );
+		glVertexAttribPointer( GLuint(loc), a.size, a.type, a.normalized, format.stride, (GLvoid*) a.offset );
+	}
+}
+
+struct cg_vao_cache
+{
+	struct entry { GLuint program, vertex_buffer, index_buffer; const cg_vertex_format* format; GLuint vao; };
+	std::vector<entry>	entries;
+	size_t				builds = 0;
+
+	~cg_vao_cache(){ clear(); }
+	static bool supported(){ return glGenVertexArrays&&glBindVertexArray&&glDeleteVertexArrays; }
+
+	// returns the VAO for the key, baking it on first use; 0 if VAOs are not supported
+	GLuint get( GLuint program, GLuint vertex_buffer, GLuint index_buffer, const cg_vertex_format& format )
+	{
+		if(!supported()) return 0;
+		for( auto& e : entries ) if(e.program==program&&e.vertex_buffer==vertex_buffer&&e.index_buffer==index_buffer&&e.format==&format) return e.vao;
+		entry e = { program, vertex_buffer, index_buffer, &format, 0 };
+		glGenVertexArrays( 1, &e.vao );
+		glBindVertexArray( e.vao );
+		cg_bind_vertex_format( program, vertex_buffer, format );
+		if(index_buffer) glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, index_buffer );
+		glBindVertexArray( 0 );
+		entries.push_back(e); builds++;
+		return e.vao;
+	}
+
+	void invalidate_buffer( GLuint buffer ){ if(buffer) remove_if( [buffer]( const entry& e ){ return e.vertex_buffer==buffer||e.index_buffer==buffer; } ); }
+	void invalidate_program( GLuint program ){ remove_if( [program]( const entry& e ){ return e.program==program; } ); }
+	void clear(){ remove_if( []( const entry& ){ return true; } ); }
+
+	template <class F> void remove_if( F pred )
+	{
+		for( size_t k=0; k<entries.size(); )
+		{
+			if(!pred(entries[k])){ k++; continue; }
+			glDeleteVertexArrays( 1, &entries[k].vao );
+			entries[k] = entries.back(); entries.pop_back();
+		}
+	}
+};
+
+//*******************************************************************
+// uniform ring: a persistently mapped uniform buffer (GL 4.4 or ARB_buffer_storage) split into one region
+// per frame in flight. push() writes a block straight into the mapped region and bind() attaches it by
+// range, so per-object data costs a memcpy and no upload call; a fence per region keeps the CPU from
+// overwriting data the GPU may still read
+struct cg_uniform_ring
+{
+	GLuint				buffer = 0;
+	char*				ptr = nullptr;			// persistent, coherent mapping
+	size_t				region_size = 0;
+	size_t				alignment = 256;		// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	size_t				region = 0, head = 0;	// current region, and the write offset in it
+	std::vector<GLsync>	fences;
+	size_t				waits = 0;				// begin_frame() calls that blocked on a fence
+
+	~cg_uniform_ring(){ release(); }
+	static bool supported(){ return glBufferStorage&&glMapBufferRange&&glFenceSync&&glBindBufferRange&&glUniformBlockBinding; }
+
+	// a region holds blocks_per_frame pushes of up to block_size bytes, each starting at the queried alignment
+	bool init( size_t block_size, size_t blocks_per_frame, int frames_in_flight=3 )
+	{
+		release(); if(!supported()) return false;
+		GLint a=0; glGetIntegerv( GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &a ); if(a>0) alignment = size_t(a);
+		region_size = (block_size+alignment-1)/alignment*alignment*blocks_per_frame;
+		fences.assign( size_t(frames_in_flight>1?frames_in_flight:2), nullptr );
+		const GLbitfield flags = GL_MAP_WRITE_BIT|GL_MAP_PERSISTENT_BIT|GL_MAP_COHERENT_BIT;
+		glGenBuffers( 1, &buffer ); glBindBuffer( GL_UNIFORM_BUFFER, buffer );
+		glBufferStorage( GL_UNIFORM_BUFFER, GLsizeiptr(region_size*fences.size()), nullptr, flags );
+		ptr = (char*) glMapBufferRange( GL_UNIFORM_BUFFER, 0, GLsizeiptr(region_size*fences.size()), flags );
+		if(!ptr){ printf( "[error] cg_uniform_ring: unable to map the buffer persistently\n" ); release(); return false; }
+		region = fences.size()-1; head = 0;
+		return true;
+	}
+
+	// moves to the next region once the GPU is done with its previous contents
+	void begin_frame()
+	{
+		region = (region+1)%fences.size(); head = 0;
+		GLsync& f = fences[region]; if(!f) return;
+		GLenum r = glClientWaitSync( f, 0, 0 );
+		if(r==GL_TIMEOUT_EXPIRED){ waits++; while( glClientWaitSync( f, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000 )==GL_TIMEOUT_EXPIRED ); }
+		glDeleteSync(f); f = nullptr;
+	}
+
+	// returns the buffer offset of the copy for bind(), or SIZE_MAX if the region is full
+	size_t push( const void* data, size_t size )
+	{
+		size_t offset = (head+alignment-1)/alignment*alignment;
+		if(!ptr||offset+size>region_size) return SIZE_MAX;
+		memcpy( ptr+region*region_size+offset, data, size ); head = offset+size;
+		return region*region_size+offset;
+	}
+
+	void bind( GLuint binding, size_t offset, size_t size ) const { glBindBufferRange( GL_UNIFORM_BUFFER, binding, buffer, GLintptr(offset), GLsizeiptr(size) ); }
+
+	// call after the draws that read the current region
+	void end_frame()
+	{
+		if(fences.empty()) return;
+		if(fences[region]) glDeleteSync(fences[region]);
+		fences[region] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+	}
+
+	void release()
+	{
+		for( auto& f : fences ) if(f) glDeleteSync(f);
+		fences.clear();
+		if(buffer&&ptr){ glBindBuffer( GL_UNIFORM_BUFFER, buffer ); glUnmapBuffer( GL_UNIFORM_BUFFER ); }
+		if(buffer) glDeleteBuffers( 1, &buffer );
+		buffer = 0; ptr = nullptr; region = head = 0;
+	}
+};
+
+// assigns a named uniform block of program to a binding point; false if the program has no such block
+inline bool cg_bind_uniform_block( GLuint program, const char* name, GLuint binding )
+{
+	GLuint index = glGetUniformBlockIndex( program, name ); if(index==GL_INVALID_INDEX) return false;
+	glUniformBlockBinding( program, index, binding );
+	return true;
+}
+
+// std140 stores matrices column by column
+template <class L> inline void cg_store_std140( float* dst, const tmat4<L>& m ){ const float* a=m; for( int r=0; r<4; r++ ) for( int c=0; c<4; c++ ) dst[c*4+r]=a[L::index(r,c,4)]; }
+
+//*******************************************************************
+// buffer object with storage reuse: an upload that fits orphans the current storage (glInvalidateBufferData,
+// or glBufferData with NULL) and refills it; one that does not grows the storage geometrically. released
+// names return to a small pool with their storage, so a rebuild of the same size needs no new name
+struct cg_buffer_stats { size_t names=0, deletes=0, allocations=0, orphans=0, uploads=0; };
+
+struct cg_buffer
+{
+	struct pooled { GLuint id; size_t capacity; };
+	GLenum	target = GL_ARRAY_BUFFER;
+	GLuint	id = 0;
+	size_t	capacity = 0;	// bytes of storage
+	size_t	size = 0;		// bytes of the last upload
+
+	explicit cg_buffer( GLenum target=GL_ARRAY_BUFFER ):target(target){}
+	cg_buffer( cg_buffer&& b ):target(b.target),id(b.id),capacity(b.capacity),size(b.size){ b.id=0; b.capacity=b.size=0; }
+	cg_buffer& operator=( cg_buffer&& b ){ if(this!=&b){ release(); target=b.target; id=b.id; capacity=b.capacity; size=b.size; b.id=0; b.capacity=b.size=0; } return *this; }
+	cg_buffer( const cg_buffer& ) = delete;
+	cg_buffer& operator=( const cg_buffer& ) = delete;
+	~cg_buffer(){ release(); }
+	operator GLuint() const { return id; }
+
+	static cg_buffer_stats& stats(){ static cg_buffer_stats s; return s; }
+	static std::vector<pooled>& pool(){ static std::vector<pooled> p; return p; }
+	static const size_t pool_size = 8;
+
+	void upload( const void* data, size_t bytes, GLenum usage=GL_STATIC_DRAW )
+	{
+		cg_buffer_stats& st = stats();
+		if(!id) // take the pooled name with the smallest sufficient storage, or any
+		{
+			std::vector<pooled>& p = pool(); size_t best = p.size();
+			for( size_t k=0; k<p.size(); k++ ) if(best==p.size()||(p[k].capacity>=bytes&&(p[best].capacity<bytes||p[k].capacity<p[best].capacity))) best=k;
+			if(best<p.size()){ id=p[best].id; capacity=p[best].capacity; p.erase(p.begin()+best); }
+			else { glGenBuffers( 1, &id ); capacity=0; st.names++; }
+		}
+		glBindBuffer( target, id );
+		if(bytes>capacity||capacity==0)
+		{
+			capacity = bytes>capacity+capacity/2 ? bytes : capacity+capacity/2;
+			glBufferData( target, GLsizeiptr(capacity), capacity==bytes?data:nullptr, usage ); st.allocations++;
+			if(capacity!=bytes&&bytes) glBufferSubData( target, 0, GLsizeiptr(bytes), data );
+		}
+		else
+		{
+			if(glInvalidateBufferData) glInvalidateBufferData(id);
+			else glBufferData( target, GLsizeiptr(capacity), nullptr, usage );
+			if(bytes) glBufferSubData( target, 0, GLsizeiptr(bytes), data );
+			st.orphans++;
+		}
+		size = bytes; st.uploads++;
+	}
+
+	// returns the name and its storage to the pool; the name is deleted if the pool is full
+	void release()
+	{
+		if(!id) return;
+		std::vector<pooled>& p = pool();
+		if(p.size()<pool_size){ pooled b={id,capacity}; p.push_back(b); }
+		else { glDeleteBuffers( 1, &id ); stats().deletes++; }
+		id = 0; capacity = size = 0;
+	}
+
+	// deletes the name without pooling it
+	void destroy(){ if(!id) return; glDeleteBuffers( 1, &id ); stats().deletes++; id = 0; capacity = size = 0; }
+
+	// call before the context goes away
+	static void clear_pool(){ for( auto& b : pool() ){ glDeleteBuffers( 1, &b.id ); stats().deletes++; } pool().clear(); }
+};
+
+//*******************************************************************
+// the vertex/index files are mapped and uploaded straight from the mapped pages;
+// host copies in vertex_list/index_list are made only if keep_host_copy is set
+inline mesh* cg_load_mesh( const char* vert_binary_path, const char* index_binary_path, bool keep_host_copy=true )
 {
+	double t0 = glfwGetTime();
+
+	// map vertex and index files
+	mmap_t v = cg_map_binary(vert_binary_path);
+	if(!v.ptr||v.size%sizeof(vertex)){ printf( "%s is not a valid vertex binary file\n", vert_binary_path ); cg_unmap_binary(v); return nullptr; }
+	mmap_t i = cg_map_binary(index_binary_path);
+	if(!i.ptr||i.size%sizeof(uint)){ printf( "%s is not a valid index binary file\n", index_binary_path ); cg_unmap_binary(v); cg_unmap_binary(i); return nullptr; }
+
 	mesh* new_mesh = new mesh();
-	
-	// load vertex buffer
-	mem_t v = cg_read_binary(vert_binary_path);
-	if(v.size%sizeof(vertex)){ printf( "%s is not a valid vertex binary file\n", vert_binary_path ); return nullptr; }
-	new_mesh->vertex_list.resize( v.size/sizeof(vertex) );
-	memcpy( &new_mesh->vertex_list[0], v.ptr, v.size );
-
-	// load index buffer
-	mem_t i = cg_read_binary(index_binary_path);
-	if(i.size%sizeof(uint)){ printf( "%s is not a valid index binary file\n", index_binary_path ); return nullptr; }
-	new_mesh->index_list.resize( v.size/sizeof(uint) );
-	memcpy( &new_mesh->index_list[0], i.ptr, i.size );
-
-	// release memory
-	if(v.ptr) free(v.ptr);
-	if(i.ptr) free(i.ptr);
+	new_mesh->vertex_count = v.size/sizeof(vertex);
+	new_mesh->index_count = i.size/sizeof(uint);
+	if(keep_host_copy)
+	{
+		new_mesh->vertex_list.assign( (const vertex*) v.ptr, (const vertex*) v.ptr + new_mesh->vertex_count );
+		new_mesh->index_list.assign( (const uint*) i.ptr, (const uint*) i.ptr + new_mesh->index_count );
+	}
 
 	// create a vertex buffer
 	glGenBuffers( 1, &new_mesh->vertex_buffer );
 	glBindBuffer( GL_ARRAY_BUFFER, new_mesh->vertex_buffer );
-	glBufferData( GL_ARRAY_BUFFER, sizeof(vertex)*new_mesh->vertex_list.size(), &new_mesh->vertex_list[0], GL_STATIC_DRAW );
+	glBufferData( GL_ARRAY_BUFFER, v.size, v.ptr, GL_STATIC_DRAW );
 
 	// create a index buffer
 	glGenBuffers( 1, &new_mesh->index_buffer );
 	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, new_mesh->index_buffer );
-	glBufferData( GL_ELEMENT_ARRAY_BUFFER, sizeof(uint)*new_mesh->index_list.size(), &new_mesh->index_list[0], GL_STATIC_DRAW );
+	glBufferData( GL_ELEMENT_ARRAY_BUFFER, i.size, i.ptr, GL_STATIC_DRAW );
+
+	// release mappings
+	cg_unmap_binary(v);
+	cg_unmap_binary(i);
 
+	printf( "> loaded %s: %zu vertices, %zu indices in %.1f ms (peak RSS %.1f MB)\n", vert_binary_path, new_mesh->vertex_count, new_mesh->index_count, (glfwGetTime()-t0)*1000.0, cg_peak_rss()/1048576.0 );
 	return new_mesh;
 }
 
+//*******************************************************************
+// mesh container export and loading
+inline uint cg_mesh_data_checksum( const char* file, const mesh_header& h )
+{
+	uint c = cg_fnv1a( file+h.vertex_offset, size_t(h.vertex_bytes) );
+	return cg_fnv1a( file+h.index_offset, size_t(h.index_bytes), c );
+}
+
+//*******************************************************************
+// mesh codec (CG_CODEC_QLZ)
+//   vertex section: [uint64 raw size][LZ of 7 uint16 streams, each as a low and a high byte plane]
+//     streams: position xyz quantized in the box, octahedral normal (2xSNORM16), texcoord (UNORM16x2);
+//     each stream holds zigzag-encoded deltas between consecutive vertices
+//   index section: [uint64 raw size][LZ of LEB128 varints of zigzag-encoded index deltas]
+// LZ sequences are LZ4-like: token (literal length:4, match length-4:4), 255-run length extensions,
+// literals, 16-bit little-endian match offset; the last sequence carries literals only
+inline void cg_lz_compress( const uchar* src, size_t n, std::vector<uchar>& dst )
+{
+	static const int hash_bits = 16;
+	std::vector<uint> table( 1<<hash_bits, 0 );	// last position+1 of each hashed 4-byte sequence
+	auto put_length = [&]( size_t len ){ for( ; len>=255; len-=255 ) dst.push_back(255); dst.push_back(uchar(len)); };
+	size_t anchor=0, p=0;
+	while( p+4<=n )
+	{
+		uint v; memcpy( &v, src+p, 4 ); uint h=(v*2654435761u)>>(32-hash_bits);
+		size_t c = table[h]; table[h] = uint(p+1);
+		if(c==0||p-(c-1)>65535||memcmp(src+c-1,src+p,4)){ p++; continue; }
+
+		size_t m=c-1, len=4; while( p+len<n&&src[m+len]==src[p+len] ) len++;
+		size_t lit=p-anchor, off=p-m;
+		dst.push_back( uchar((min(lit,size_t(15))<<4)|min(len-4,size_t(15))) );
+		if(lit>=15) put_length(lit-15);
+		dst.insert( dst.end(), src+anchor, src+p );
+		dst.push_back(uchar(off)); dst.push_back(uchar(off>>8));
+		if(len-4>=15) put_length(len-4-15);
+		anchor = p += len;
+	}
+	size_t lit = n-anchor;
+	dst.push_back( uchar(min(lit,size_t(15))<<4) );
+	if(lit>=15) put_length(lit-15);
+	dst.insert( dst.end(), src+anchor, src+n );
+}
+
+// returns false on malformed input or if dst is not filled exactly; copies run in 16-byte chunks where the bounds allow
+inline bool cg_lz_decompress( const uchar* src, size_t n, uchar* dst, size_t dst_size )
+{
+	const uchar *ip=src, *iend=src+n; uchar *op=dst, *oend=dst+dst_size;
+	auto get_length = [&]( size_t& len ){ uchar b; do{ if(ip>=iend) return false; b=*ip++; len+=b; } while(b==255); return true; };
+	while( ip<iend )
+	{
+		uint token = *ip++;
+		size_t lit = token>>4; if(lit==15&&!get_length(lit)) return false;
+		if(lit>size_t(iend-ip)||lit>size_t(oend-op)) return false;
+		if(lit<=16&&iend-ip>=16&&oend-op>=16) memcpy( op, ip, 16 ); else memcpy( op, ip, lit );
+		op += lit; ip += lit;
+		if(ip==iend) break;
+
+		if(iend-ip<2) return false;
+		size_t off = ip[0]|(size_t(ip[1])<<8); ip += 2;
+		size_t len = token&15; if(len==15&&!get_length(len)) return false; len += 4;
+		if(off==0||off>size_t(op-dst)||len>size_t(oend-op)) return false;
+		const uchar* m = op-off;
+		if(size_t(oend-op)<len+15)	for( size_t k=0; k<len; k++ ) op[k] = m[k];
+		else if(off>=16)			for( size_t k=0; k<len; k+=16 ) memcpy( op+k, m+k, 16 );
+		else // short period: expand 16 bytes, then copy 8-byte chunks from a whole number of periods back
+		{
+			for( size_t k=0; k<16; k++ ) op[k] = m[k];
+			for( size_t k=16, p=16/off*off; k<len; k+=8 ) memcpy( op+k, op+k-p, 8 );
+		}
+		op += len;
+	}
+	return op==oend;
+}
+
+inline void cg_encode_vertices( const vertex* v, size_t n, const aabb& box, std::vector<uchar>& dst )
+{
+	std::vector<uchar> raw(n*14);
+	vec3 scale = box.hi-box.lo; for( int c=0; c<3; c++ ) scale[c] = scale[c]>0 ? 65535.0f/scale[c] : 0;
+	ushort prev[7] = {0};
+	for( size_t k=0; k<n; k++ )
+	{
+		uint o=oct_encode(v[k].norm), t=pack_unorm16x2(v[k].tex); ushort q[7];
+		for( int c=0; c<3; c++ ) q[c] = ushort(min(uint((v[k].pos[c]-box.lo[c])*scale[c]+0.5f),65535u));
+		q[3]=ushort(o); q[4]=ushort(o>>16); q[5]=ushort(t); q[6]=ushort(t>>16);
+		for( int s=0; s<7; s++ )
+		{
+			uint d=ushort(q[s]-prev[s]), z=((d<<1)^(d&0x8000?0xffff:0))&0xffff; prev[s]=q[s];
+			raw[n*2*s+k]=uchar(z); raw[n*(2*s+1)+k]=uchar(z>>8);
+		}
+	}
+	uint64_t raw_size=raw.size(); dst.insert( dst.end(), (const uchar*)&raw_size, (const uchar*)&raw_size+8 );
+	if(n) cg_lz_compress( &raw[0], raw.size(), dst );
+}
+
+inline bool cg_decode_vertices( const uchar* src, size_t size, const aabb& box, vertex* v, size_t n )
+{
+	uint64_t raw_size; if(size<8) return false; memcpy( &raw_size, src, 8 ); if(raw_size!=n*14) return false;
+	std::vector<uchar> raw(n*14);
+	if(n&&!cg_lz_decompress( src+8, size-8, &raw[0], raw.size() )) return false;
+
+	// blocks of 1024 vertices: undo zigzag deltas of each stream into L1-resident arrays, then dequantize
+	static const size_t block = 1024;
+	ushort q[7][block]; uint sum[7] = {0};
+	vec3 scale = (box.hi-box.lo)/65535.0f;
+	for( size_t base=0; base<n; base+=block )
+	{
+		size_t bn = min(block,n-base);
+		for( size_t s=0; s<7; s++ )
+		{
+			const uchar *lo=&raw[n*2*s+base], *hi=lo+n; uint p=sum[s]; size_t k=0;
+#ifdef CGMATH_SSE2
+			// eight 16-bit lanes: interleave planes, unzigzag, log-step prefix sum, add the carried sum
+			__m128i carry=_mm_set1_epi16(short(p)), one=_mm_set1_epi16(1), zero=_mm_setzero_si128();
+			for( ; k+8<=bn; k+=8 )
+			{
+				__m128i z=_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(lo+k)),_mm_loadl_epi64((const __m128i*)(hi+k)));
+				__m128i d=_mm_xor_si128(_mm_srli_epi16(z,1),_mm_sub_epi16(zero,_mm_and_si128(z,one)));
+				d=_mm_add_epi16(d,_mm_slli_si128(d,2)); d=_mm_add_epi16(d,_mm_slli_si128(d,4)); d=_mm_add_epi16(d,_mm_slli_si128(d,8));
+				d=_mm_add_epi16(d,carry); _mm_storeu_si128((__m128i*)(q[s]+k),d);
+				carry=_mm_shufflehi_epi16(d,0xff); carry=_mm_unpackhi_epi64(carry,carry);
+			}
+			if(k) p=q[s][k-1];
+#endif
+			for( ; k<bn; k++ ){ uint z=lo[k]|(uint(hi[k])<<8); p+=(z>>1)^(0u-(z&1)); q[s][k]=ushort(p); }
+			sum[s] = p;
+		}
+
+		vertex* dst = v+base; size_t k=0;
+#ifdef CGMATH_SSE2
+		// four vertices per iteration; (pos,norm.x) and (norm.yz,tex) are transposed into the 32-byte vertices
+		const __m128i zero=_mm_setzero_si128();
+		const __m128 lo_x=_mm_set1_ps(box.lo.x), lo_y=_mm_set1_ps(box.lo.y), lo_z=_mm_set1_ps(box.lo.z);
+		const __m128 sc_x=_mm_set1_ps(scale.x), sc_y=_mm_set1_ps(scale.y), sc_z=_mm_set1_ps(scale.z);
+		const __m128 one=_mm_set1_ps(1.0f), neg_one=_mm_set1_ps(-1.0f), inv_u=_mm_set1_ps(1/65535.0f);
+		const __m128 sign=_mm_set1_ps(-0.0f), snorm=_mm_set1_ps(32767.0f);
+		auto u16 = [&]( const ushort* p ){ return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)p),zero)); };
+		auto s16 = [&]( const ushort* p ){ __m128i t=_mm_loadl_epi64((const __m128i*)p); return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(t,t),16)); };
+		for( ; k+4<=bn; k+=4 )
+		{
+			__m128 px=_mm_add_ps(lo_x,_mm_mul_ps(u16(q[0]+k),sc_x)), py=_mm_add_ps(lo_y,_mm_mul_ps(u16(q[1]+k),sc_y)), pz=_mm_add_ps(lo_z,_mm_mul_ps(u16(q[2]+k),sc_z));
+			__m128 x=_mm_max_ps(_mm_div_ps(s16(q[3]+k),snorm),neg_one), y=_mm_max_ps(_mm_div_ps(s16(q[4]+k),snorm),neg_one);
+			__m128 ax=_mm_andnot_ps(sign,x), ay=_mm_andnot_ps(sign,y), z=_mm_sub_ps(_mm_sub_ps(one,ax),ay);
+			__m128 fold=_mm_cmplt_ps(z,_mm_setzero_ps());
+			__m128 fx=_mm_or_ps(_mm_sub_ps(one,ay),_mm_and_ps(x,sign)), fy=_mm_or_ps(_mm_sub_ps(one,ax),_mm_and_ps(y,sign));
+			x=_mm_or_ps(_mm_and_ps(fold,fx),_mm_andnot_ps(fold,x)); y=_mm_or_ps(_mm_and_ps(fold,fy),_mm_andnot_ps(fold,y));
+			__m128 len=_mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x,x),_mm_mul_ps(y,y)),_mm_mul_ps(z,z)));
+			__m128 nx=_mm_div_ps(x,len), ny=_mm_div_ps(y,len), nz=_mm_div_ps(z,len);
+			__m128 tu=_mm_mul_ps(u16(q[5]+k),inv_u), tv=_mm_mul_ps(u16(q[6]+k),inv_u);
+			_MM_TRANSPOSE4_PS(px,py,pz,nx); _MM_TRANSPOSE4_PS(ny,nz,tu,tv);
+			float* f=&dst[k].pos.x;
+			_mm_storeu_ps(f,px); _mm_storeu_ps(f+4,ny); _mm_storeu_ps(f+8,py); _mm_storeu_ps(f+12,nz);
+			_mm_storeu_ps(f+16,pz); _mm_storeu_ps(f+20,tu); _mm_storeu_ps(f+24,nx); _mm_storeu_ps(f+28,tv);
+		}
+#endif
+		for( ; k<bn; k++ )
+		{
+			dst[k].pos = vec3( box.lo.x+q[0][k]*scale.x, box.lo.y+q[1][k]*scale.y, box.lo.z+q[2][k]*scale.z );
+			dst[k].norm = oct_decode( q[3][k]|(uint(q[4][k])<<16) );
+			dst[k].tex = vec2( q[5][k]*(1/65535.0f), q[6][k]*(1/65535.0f) );
+		}
+	}
+	return true;
+}
+
+inline void cg_encode_indices( const uint* index, size_t n, std::vector<uchar>& dst )
+{
+	std::vector<uchar> raw; raw.reserve(n*2);
+	for( size_t k=0; k<n; k++ )
+	{
+		uint d=index[k]-(k?index[k-1]:0), z=(d<<1)^(0u-(d>>31));
+		for( ; z>=128; z>>=7 ) raw.push_back(uchar(z|128));
+		raw.push_back(uchar(z));
+	}
+	uint64_t raw_size=raw.size(); dst.insert( dst.end(), (const uchar*)&raw_size, (const uchar*)&raw_size+8 );
+	if(n) cg_lz_compress( &raw[0], raw.size(), dst );
+}
+
+inline bool cg_decode_indices( const uchar* src, size_t size, uint* index, size_t n )
+{
+	uint64_t raw_size; if(size<8) return false; memcpy( &raw_size, src, 8 ); if(raw_size<n||raw_size>n*5) return false;
+	std::vector<uchar> raw( size_t(raw_size)+1 );	// +1 for an empty stream
+	if(n&&!cg_lz_decompress( src+8, size-8, &raw[0], size_t(raw_size) )) return false;
+
+	const uchar *p=&raw[0], *e=p+raw_size; uint prev=0;
+	for( size_t k=0; k<n; k++ )
+	{
+		uint z=0; for( int shift=0; ; shift+=7 ){ if(p>=e||shift>28) return false; uint b=*p++; z|=(b&127)<<shift; if(b<128) break; }
+		index[k] = prev += (z>>1)^(0u-(z&1));
+	}
+	return p==e;
+}
+
+// codec=CG_CODEC_QLZ stores quantized, compressed sections; they decode to vertex (or packed_vertex) and 32-bit indices
+inline bool cg_save_mesh_file( const char* path, const std::vector<vertex>& vertices, const std::vector<uint>& indices, bool packed=false, cg_mesh_codec codec=CG_CODEC_NONE )
+{
+	if(vertices.empty()){ printf( "[error] cg_save_mesh_file(): no vertices to write\n" ); return false; }
+
+	mesh_header h = {};
+	h.magic = CG_MESH_MAGIC;
+	h.version = CG_MESH_VERSION;
+	h.header_size = sizeof(mesh_header);
+	h.vertex_layout = packed ? CG_LAYOUT_PACKED_VERTEX : CG_LAYOUT_VERTEX;
+	h.vertex_stride = packed ? sizeof(packed_vertex) : sizeof(vertex);
+	h.index_width = indices.empty() ? 0 : vertices.size()<=65536&&codec==CG_CODEC_NONE ? 2 : 4;
+	h.codec = codec;
+	h.vertex_count = vertices.size();
+	h.index_count = indices.size();
+
+	// bounds: box, and a sphere around the box center
+	h.box.lo = h.box.hi = vertices[0].pos;
+	for( auto& v : vertices ) for( int k=0; k<3; k++ ){ h.box.lo[k]=min(h.box.lo[k],v.pos[k]); h.box.hi[k]=max(h.box.hi[k],v.pos[k]); }
+	vec3 center = (h.box.lo+h.box.hi)*0.5f; float r2 = 0;
+	for( auto& v : vertices ) r2 = max(r2,(v.pos-center).length2());
+	h.sphere = vec4( center, sqrt(r2) );
+
+	// encode sections before the layout is known
+	std::vector<uchar> encoded_vertices, encoded_indices;
+	if(codec==CG_CODEC_QLZ)
+	{
+		cg_encode_vertices( &vertices[0], vertices.size(), h.box, encoded_vertices );
+		if(!indices.empty()) cg_encode_indices( &indices[0], indices.size(), encoded_indices );	// no section without indices: index_width is 0
+	}
+	h.vertex_bytes = codec ? encoded_vertices.size() : h.vertex_count*h.vertex_stride;
+	h.index_bytes = codec ? encoded_indices.size() : h.index_count*h.index_width;
+	h.vertex_offset = (sizeof(mesh_header)+CG_MESH_ALIGN-1)/CG_MESH_ALIGN*CG_MESH_ALIGN;
+	h.index_offset = (h.vertex_offset+h.vertex_bytes+CG_MESH_ALIGN-1)/CG_MESH_ALIGN*CG_MESH_ALIGN;
+	h.file_size = h.index_offset+h.index_bytes;
+
+	// build the file image: indices are narrowed to 16 bits when possible
+	std::vector<char> file( size_t(h.file_size), 0 );
+	if(codec)
+	{
+		memcpy( &file[size_t(h.vertex_offset)], &encoded_vertices[0], encoded_vertices.size() );
+		if(!encoded_indices.empty()) memcpy( &file[size_t(h.index_offset)], &encoded_indices[0], encoded_indices.size() );
+	}
+	else
+	{
+		if(packed){ std::vector<packed_vertex> p=cg_pack_vertices(vertices); memcpy( &file[size_t(h.vertex_offset)], &p[0], p.size()*sizeof(packed_vertex) ); }
+		else memcpy( &file[size_t(h.vertex_offset)], &vertices[0], vertices.size()*sizeof(vertex) );
+		if(h.index_width==2){ ushort* dst=(ushort*)&file[size_t(h.index_offset)]; for( size_t k=0; k<indices.size(); k++ ) dst[k]=ushort(indices[k]); }
+		else if(h.index_width==4) memcpy( &file[size_t(h.index_offset)], &indices[0], indices.size()*sizeof(uint) );
+	}
+	h.data_checksum = cg_mesh_data_checksum( &file[0], h );
+	h.header_checksum = cg_fnv1a( &h, offsetof(mesh_header,header_checksum) );
+	memcpy( &file[0], &h, sizeof(h) );
+
+	FILE* fp = fopen( path, "wb" ); if(fp==nullptr){ printf( "[error] Unable to open %s\n", path ); return false; }
+	bool b = fwrite( &file[0], 1, file.size(), fp )==file.size();
+	fclose(fp);
+	if(!b) printf( "[error] Unable to write %s\n", path );
+	return b;
+}
+
+// O(1) validation: header fields and section extents against the file size; the data checksum is left to cg_mesh_data_checksum()
+inline bool cg_validate_mesh_header( const mesh_header* h, uint64_t file_size, const char* path )
+{
+	const uint64_t size = file_size;
+	const char* error = nullptr;
+	if(size<sizeof(mesh_header)||h->magic!=CG_MESH_MAGIC)						error = "not a mesh file";
+	else if(h->version!=CG_MESH_VERSION||h->header_size!=sizeof(mesh_header))	error = "unsupported version";
+	else if(h->header_checksum!=cg_fnv1a(h,offsetof(mesh_header,header_checksum)))	error = "corrupted header";
+	else if(h->file_size!=size)													error = "truncated file";
+	else if(h->vertex_layout==CG_LAYOUT_VERTEX ? h->vertex_stride!=sizeof(vertex) : h->vertex_layout!=CG_LAYOUT_PACKED_VERTEX||h->vertex_stride!=sizeof(packed_vertex)) error = "unknown vertex layout";
+	else if(h->index_width!=0&&h->index_width!=2&&h->index_width!=4)			error = "unknown index width";
+	else if(h->index_width==0&&(h->index_count||h->index_bytes))				error = "indices without an index width";
+	else if(h->codec!=CG_CODEC_NONE&&(h->codec!=CG_CODEC_QLZ||h->index_width==2))	error = "unknown codec";
+	else if(h->vertex_offset%CG_MESH_ALIGN||h->index_offset%CG_MESH_ALIGN||h->vertex_offset<sizeof(mesh_header)) error = "misaligned sections";
+	else if(h->vertex_offset>size||h->vertex_bytes>size-h->vertex_offset||h->vertex_offset+h->vertex_bytes>h->index_offset) error = "vertex section out of range";
+	else if(h->index_offset>size||h->index_bytes>size-h->index_offset)			error = "index section out of range";
+	else if(h->codec==CG_CODEC_NONE ? h->vertex_count>size/h->vertex_stride||h->vertex_bytes!=h->vertex_count*h->vertex_stride||(h->index_width&&h->index_count>size/h->index_width)||h->index_bytes!=h->index_count*h->index_width
+		: h->vertex_bytes<8||(h->index_count&&h->index_bytes<8)||h->vertex_count>h->vertex_bytes*255/14||h->index_count>h->index_bytes*255) error = "inconsistent section sizes";	// LZ expands at most ~255x
+	if(error){ printf( "[error] %s: %s\n", path, error ); return false; }
+	return true;
+}
+
+inline const mesh_header* cg_validate_mesh_header( const mmap_t& m, const char* path )
+{
+	const mesh_header* h = (const mesh_header*) m.ptr;
+	if(m.size<sizeof(mesh_header)){ printf( "[error] %s: not a mesh file\n", path ); return nullptr; }
+	return cg_validate_mesh_header( h, m.size, path ) ? h : nullptr;
+}
+
+// streams the vertex and index sections through one chunk_size buffer, so host memory stays at chunk_size
+// regardless of the mesh size; upload() must consume the chunk before returning (glBufferSubData copies it).
+// h is filled before the first call of upload( section, offset, data, size ), where section is 0 for vertices and 1 for indices.
+template <class F> inline bool cg_stream_mesh_file( const char* path, mesh_header& h, F upload, size_t chunk_size=4<<20 )
+{
+	FILE* fp = fopen( path, "rb" ); if(fp==nullptr){ printf( "[error] Unable to open %s\n", path ); return false; }
+#ifdef _WIN32
+	_fseeki64( fp, 0, SEEK_END ); uint64_t file_size = uint64_t(_ftelli64(fp)); _fseeki64( fp, 0, SEEK_SET );
+#else
+	fseeko( fp, 0, SEEK_END ); uint64_t file_size = uint64_t(ftello(fp)); fseeko( fp, 0, SEEK_SET );
+#endif
+	if(fread(&h,sizeof(h),1,fp)!=1){ h = mesh_header(); file_size=0; }
+	if(!cg_validate_mesh_header(&h,file_size,path)){ fclose(fp); return false; }
+	if(h.codec!=CG_CODEC_NONE){ printf( "[error] %s: compressed sections cannot be streamed\n", path ); fclose(fp); return false; }
+
+	// sections are read in order; the gaps before them are skipped, since the validator bounds them only by the file size
+	std::vector<char> chunk( max(chunk_size,size_t(1)) );
+	uint64_t begin[2] = { h.vertex_offset, h.index_offset }, size[2] = { h.vertex_bytes, h.index_bytes };
+	bool b = true;
+	for( int section=0; section<2&&b; section++ )
+	{
+#ifdef _WIN32
+		if(_fseeki64( fp, __int64(begin[section]), SEEK_SET )!=0){ b=false; break; }
+#else
+		if(fseeko( fp, off_t(begin[section]), SEEK_SET )!=0){ b=false; break; }
+#endif
+		for( uint64_t offset=0; offset<size[section]; offset+=chunk.size() )
+		{
+			size_t n = size_t(min(uint64_t(chunk.size()),size[section]-offset));
+			if(fread(&chunk[0],n,1,fp)!=1){ b=false; break; }
+			upload( section, offset, &chunk[0], n );
+		}
+	}
+	fclose(fp);
+	if(!b) printf( "[error] %s: read failed\n", path );
+	return b;
+}
+
+// copies uncompressed sections into host memory; packed vertices are expanded and 16-bit indices widened
+inline void cg_copy_mesh_sections( const mesh_header& h, const char* vertices, const char* indices, vertex* v, uint* i )
+{
+	const size_t vn=size_t(h.vertex_count), in=size_t(h.index_count);
+	if(h.vertex_layout==CG_LAYOUT_VERTEX){ if(vn) memcpy( (void*) v, vertices, vn*sizeof(vertex) ); }	// vertex is plain data
+	else for( size_t k=0; k<vn; k++ ){ const packed_vertex& p=((const packed_vertex*)vertices)[k]; v[k].pos=p.pos; vec4 n=unpack_snorm_1010102(p.norm); v[k].norm=vec3(n.x,n.y,n.z); v[k].tex=unpack_unorm16x2(p.tex); }
+	if(h.index_width==2) for( size_t k=0; k<in; k++ ) i[k]=((const ushort*)indices)[k];
+	else if(in) memcpy( i, indices, in*sizeof(uint) );
+}
+
+inline void cg_copy_mesh_sections( const mesh_header& h, const char* vertices, const char* indices, std::vector<vertex>& v, std::vector<uint>& i )
+{
+	v.resize(size_t(h.vertex_count)); i.resize(size_t(h.index_count));
+	cg_copy_mesh_sections( h, vertices, indices, v.empty()?nullptr:&v[0], i.empty()?nullptr:&i[0] );
+}
+
+// stream_chunk>0 selects the streaming mode: sections go through cg_stream_mesh_file() into preallocated
+// buffers with glBufferSubData, and no host copies are kept
+inline mesh* cg_load_mesh_file( const char* path, bool keep_host_copy=true, size_t stream_chunk=0 )
+{
+	double t0 = glfwGetTime();
+
+	if(stream_chunk)
+	{
+		mesh_header h; mesh* new_mesh = new mesh();
+		glGenBuffers( 1, &new_mesh->vertex_buffer );
+		glGenBuffers( 1, &new_mesh->index_buffer );
+		auto upload = [&]( int section, uint64_t offset, const char* data, size_t size )
+		{
+			GLenum target = section==0 ? GL_ARRAY_BUFFER : GL_ELEMENT_ARRAY_BUFFER;
+			glBindBuffer( target, section==0 ? new_mesh->vertex_buffer : new_mesh->index_buffer );
+			if(offset==0) glBufferData( target, GLsizeiptr(section==0?h.vertex_count*h.vertex_stride:h.index_count*h.index_width), nullptr, GL_STATIC_DRAW );
+			glBufferSubData( target, GLintptr(offset), GLsizeiptr(size), data );
+		};
+		if(!cg_stream_mesh_file( path, h, upload, stream_chunk ))
+		{
+			glDeleteBuffers( 1, &new_mesh->vertex_buffer );
+			glDeleteBuffers( 1, &new_mesh->index_buffer );
+			delete new_mesh; return nullptr;
+		}
+		if(!h.index_count){ glDeleteBuffers( 1, &new_mesh->index_buffer ); new_mesh->index_buffer = 0; }
+		new_mesh->vertex_count = size_t(h.vertex_count);
+		new_mesh->index_count = size_t(h.index_count);
+		new_mesh->index_type = h.index_width==2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		new_mesh->packed = h.vertex_layout==CG_LAYOUT_PACKED_VERTEX;
+		new_mesh->box = h.box;
+		new_mesh->sphere = h.sphere;
+		printf( "> streamed %s: %zu vertices, %zu indices in %.1f ms (peak RSS %.1f MB)\n", path, new_mesh->vertex_count, new_mesh->index_count, (glfwGetTime()-t0)*1000.0, cg_peak_rss()/1048576.0 );
+		return new_mesh;
+	}
+
+	mmap_t m = cg_map_binary(path); if(!m.ptr) return nullptr;
+	const mesh_header* h = cg_validate_mesh_header( m, path ); if(!h){ cg_unmap_binary(m); return nullptr; }
+#ifdef _DEBUG
+	if(h->data_checksum!=cg_mesh_data_checksum(m.ptr,*h)){ printf( "[error] %s: checksum mismatch\n", path ); cg_unmap_binary(m); return nullptr; }
+#endif
+	const char* vertices = m.ptr+h->vertex_offset;
+	const char* indices = m.ptr+h->index_offset;
+
+	mesh* new_mesh = new mesh();
+	new_mesh->vertex_count = size_t(h->vertex_count);
+	new_mesh->index_count = size_t(h->index_count);
+	new_mesh->index_type = h->index_width==2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	new_mesh->packed = h->vertex_layout==CG_LAYOUT_PACKED_VERTEX;
+	new_mesh->box = h->box;
+	new_mesh->sphere = h->sphere;
+
+	// compressed sections decode into the host lists; they are dropped after upload unless keep_host_copy is set
+	std::vector<packed_vertex> packed;
+	if(h->codec!=CG_CODEC_NONE)
+	{
+		new_mesh->vertex_list.resize(new_mesh->vertex_count);
+		new_mesh->index_list.resize(new_mesh->index_count);
+		if(!cg_decode_vertices( (const uchar*) vertices, size_t(h->vertex_bytes), h->box, &new_mesh->vertex_list[0], new_mesh->vertex_count )||
+			(h->index_count&&!cg_decode_indices( (const uchar*) indices, size_t(h->index_bytes), &new_mesh->index_list[0], new_mesh->index_count )))
+		{
+			printf( "[error] %s: corrupted compressed sections\n", path ); delete new_mesh; cg_unmap_binary(m); return nullptr;
+		}
+		if(new_mesh->packed) packed = cg_pack_vertices(new_mesh->vertex_list);
+		vertices = new_mesh->packed ? (const char*) &packed[0] : (const char*) &new_mesh->vertex_list[0];
+		indices = h->index_count ? (const char*) &new_mesh->index_list[0] : nullptr;
+	}
+
+	// host copies are allocated exactly once from the header counts
+	else if(keep_host_copy) cg_copy_mesh_sections( *h, vertices, indices, new_mesh->vertex_list, new_mesh->index_list );
+
+	// create vertex and index buffers from the mapped sections
+	glGenBuffers( 1, &new_mesh->vertex_buffer );
+	glBindBuffer( GL_ARRAY_BUFFER, new_mesh->vertex_buffer );
+	glBufferData( GL_ARRAY_BUFFER, GLsizeiptr(h->vertex_count*h->vertex_stride), vertices, GL_STATIC_DRAW );
+	if(h->index_count)
+	{
+		glGenBuffers( 1, &new_mesh->index_buffer );
+		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, new_mesh->index_buffer );
+		glBufferData( GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(h->index_count*h->index_width), indices, GL_STATIC_DRAW );
+	}
+
+	if(!keep_host_copy){ std::vector<vertex>().swap(new_mesh->vertex_list); std::vector<uint>().swap(new_mesh->index_list); }
+	cg_unmap_binary(m);
+	printf( "> loaded %s: %zu vertices, %zu indices in %.1f ms (peak RSS %.1f MB)\n", path, new_mesh->vertex_count, new_mesh->index_count, (glfwGetTime()-t0)*1000.0, cg_peak_rss()/1048576.0 );
+	return new_mesh;
+}
+
+// pooled meshes release their GL objects here and their memory with the pool
+inline void cg_delete_mesh( mesh*& m )
+{
+	if(!m) return;
+	if(m->vertex_buffer) glDeleteBuffers( 1, &m->vertex_buffer );
+	if(m->index_buffer) glDeleteBuffers( 1, &m->index_buffer );
+	if(m->texture) glDeleteTextures( 1, &m->texture );
+	m->vertex_buffer = m->index_buffer = m->texture = 0;
+	if(!m->pooled) delete m;
+	m = nullptr;
+}
+
+//*******************************************************************
+// arena: bump allocation from large blocks, released only in bulk; requests larger than
+// a block get a dedicated one. allocations counts the blocks taken from the heap
+struct cg_arena
+{
+	std::vector<char*>	blocks;
+	size_t				block_size = 4<<20;
+	size_t				used = 0, capacity = 0;	// in the current (last) block
+	size_t				allocations = 0, requests = 0, bytes = 0;
+
+	~cg_arena(){ release(); }
+
+	static char* aligned( char* p, size_t align ){ return (char*)((uintptr_t(p)+align-1)&~uintptr_t(align-1)); }
+
+	void* alloc( size_t size, size_t align=16 )
+	{
+		if(size+align>block_size) // dedicated block, inserted behind the current one
+		{
+			char* b = (char*) malloc(size+align); if(!b) return nullptr;
+			blocks.insert( blocks.empty()?blocks.end():blocks.end()-1, b );
+			allocations++; requests++; bytes += size;
+			return aligned(b,align);
+		}
+		char* p = blocks.empty() ? nullptr : aligned(blocks.back()+used,align);
+		if(!p||p+size>blocks.back()+capacity)
+		{
+			char* b = (char*) malloc(block_size); if(!b) return nullptr;
+			blocks.push_back(b); used = 0; capacity = block_size; p = aligned(b,align);
+			allocations++;
+		}
+		used = size_t(p+size-blocks.back()); requests++; bytes += size;
+		return p;
+	}
+
+	void release()
+	{
+		for( char* b : blocks ) free(b);
+		blocks.clear(); used = capacity = 0;
+	}
+};
+
+//*******************************************************************
+// mesh pool: each mesh is placed in the arena with its host geometry right behind it,
+// so loading many small meshes costs a few block allocations; release() unloads them all at once
+struct cg_mesh_pool
+{
+	cg_arena					arena;
+	std::vector<mesh*>			meshes;
+	std::vector<packed_vertex>	scratch;	// reused for packing compressed meshes on upload
+
+	~cg_mesh_pool(){ release(); }
+
+	// host-only: vertex and index storage follows the mesh header in one arena allocation
+	mesh* create( size_t vertex_count, size_t index_count )
+	{
+		size_t vo = (sizeof(mesh)+15)&~size_t(15), io = vo+vertex_count*sizeof(vertex);
+		char* p = (char*) arena.alloc( io+index_count*sizeof(uint) ); if(!p) return nullptr;
+		mesh* m = new (p) mesh();
+		m->pooled = true;
+		m->vertex_count = vertex_count; m->index_count = index_count;
+		m->vertices = vertex_count ? (vertex*)(p+vo) : nullptr;
+		m->indices = index_count ? (uint*)(p+io) : nullptr;
+		meshes.push_back(m);
+		return m;
+	}
+
+	// loads a mesh container (cg_save_mesh_file); without keep_host_copy only the header is placed in the arena
+	mesh* load( const char* path, bool keep_host_copy=true )
+	{
+		mmap_t f = cg_map_binary(path); if(!f.ptr) return nullptr;
+		const mesh_header* h = cg_validate_mesh_header( f, path ); if(!h){ cg_unmap_binary(f); return nullptr; }
+		const bool decode = h->codec!=CG_CODEC_NONE, host = keep_host_copy||decode;
+		mesh* m = create( host?size_t(h->vertex_count):0, host?size_t(h->index_count):0 ); if(!m){ cg_unmap_binary(f); return nullptr; }
+		m->vertex_count = size_t(h->vertex_count); m->index_count = size_t(h->index_count);
+		m->index_type = h->index_width==2&&!decode ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		m->packed = h->vertex_layout==CG_LAYOUT_PACKED_VERTEX;
+		m->box = h->box; m->sphere = h->sphere;
+
+		const char* vertices = f.ptr+h->vertex_offset;
+		const char* indices = f.ptr+h->index_offset;
+		if(decode)
+		{
+			if(!cg_decode_vertices( (const uchar*) vertices, size_t(h->vertex_bytes), h->box, m->vertices, m->vertex_count )||
+				(m->index_count&&!cg_decode_indices( (const uchar*) indices, size_t(h->index_bytes), m->indices, m->index_count )))
+			{
+				printf( "[error] %s: corrupted compressed sections\n", path ); cg_unmap_binary(f); m->vertices = nullptr; m->indices = nullptr; m->vertex_count = m->index_count = 0; return nullptr;
+			}
+			if(m->packed){ scratch.resize(m->vertex_count); pack_snorm_1010102( &m->vertices[0].norm, &scratch[0].norm, m->vertex_count, sizeof(vertex), sizeof(packed_vertex) ); pack_unorm16x2( &m->vertices[0].tex, &scratch[0].tex, m->vertex_count, sizeof(vertex), sizeof(packed_vertex) ); for( size_t k=0; k<m->vertex_count; k++ ) scratch[k].pos=m->vertices[k].pos; }
+			vertices = m->packed ? (const char*) &scratch[0] : (const char*) m->vertices;
+			indices = (const char*) m->indices;
+		}
+		else if(keep_host_copy) cg_copy_mesh_sections( *h, vertices, indices, m->vertices, m->indices );
+
+		upload( m, vertices, size_t(h->vertex_count*(decode?(m->packed?sizeof(packed_vertex):sizeof(vertex)):h->vertex_stride)), indices, size_t(h->index_count*(decode?sizeof(uint):h->index_width)) );
+		if(!keep_host_copy){ m->vertices = nullptr; m->indices = nullptr; }
+		cg_unmap_binary(f);
+		return m;
+	}
+
+	// creates the GL buffers of a pooled mesh from host memory (its own geometry by default)
+	void upload( mesh* m, const void* vertices=nullptr, size_t vertex_bytes=0, const void* indices=nullptr, size_t index_bytes=0 )
+	{
+		if(!vertices){ vertices = m->vertices; vertex_bytes = m->vertex_count*sizeof(vertex); indices = m->indices; index_bytes = m->index_count*sizeof(uint); m->packed = false; m->index_type = GL_UNSIGNED_INT; }
+		if(!m->vertex_buffer) glGenBuffers( 1, &m->vertex_buffer );
+		glBindBuffer( GL_ARRAY_BUFFER, m->vertex_buffer );
+		glBufferData( GL_ARRAY_BUFFER, GLsizeiptr(vertex_bytes), vertices, GL_STATIC_DRAW );
+		if(!index_bytes) return;
+		if(!m->index_buffer) glGenBuffers( 1, &m->index_buffer );
+		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, m->index_buffer );
+		glBufferData( GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(index_bytes), indices, GL_STATIC_DRAW );
+	}
+
+	// unloads every mesh of the pool: GL objects, then the arena in bulk; pointers from create()/load() become invalid
+	void release()
+	{
+		for( mesh* m : meshes ){ mesh* p=m; cg_delete_mesh(p); m->~mesh(); }
+		meshes.clear();
+		std::vector<packed_vertex>().swap(scratch);
+		arena.release();
+	}
+};
+
+//*******************************************************************
+// range allocation: first fit over a free list of [offset,offset+size) ranges that coalesce on free
+struct cg_range_allocator
+{
+	size_t					capacity = 0;
+	std::map<size_t,size_t>	free_ranges;	// offset -> size; never adjacent
+
+	void reset( size_t size ){ capacity = size; free_ranges.clear(); if(size) free_ranges[0] = size; }
+	void grow( size_t size ){ if(size<=capacity) return; size_t old=capacity; capacity = size; free( old, size-old ); }
+
+	// returns SIZE_MAX if no free range fits
+	size_t alloc( size_t size, size_t align=1 )
+	{
+		for( auto it=free_ranges.begin(); it!=free_ranges.end(); ++it )
+		{
+			size_t start=it->first, end=start+it->second, offset=(start+align-1)/align*align;
+			if(offset+size>end) continue;
+			free_ranges.erase(it);
+			if(offset>start) free_ranges[start] = offset-start;
+			if(offset+size<end) free_ranges[offset+size] = end-offset-size;
+			return offset;
+		}
+		return SIZE_MAX;
+	}
+
+	void free( size_t offset, size_t size )
+	{
+		if(!size) return;
+		auto next = free_ranges.lower_bound(offset);
+		if(next!=free_ranges.begin()){ auto prev=std::prev(next); if(prev->first+prev->second==offset){ offset=prev->first; size+=prev->second; free_ranges.erase(prev); } }
+		if(next!=free_ranges.end()&&offset+size==next->first){ size+=next->second; free_ranges.erase(next); }
+		free_ranges[offset] = size;
+	}
+
+	size_t free_bytes() const { size_t s=0; for( auto& r : free_ranges ) s+=r.second; return s; }
+	size_t largest_free() const { size_t s=0; for( auto& r : free_ranges ) s=r.second>s?r.second:s; return s; }
+};
+
+//*******************************************************************
+// shared buffers: many meshes sub-allocated in one vertex buffer and one 32-bit index buffer, so a scene
+// binds once and draws each mesh with its base vertex. buffers grow by doubling and defragment() compacts
+// them, both by GPU copies; requires GL 3.2 (or ARB_copy_buffer and ARB_draw_elements_base_vertex).
+// growth (in add()) and defragment() replace vertex_buffer/index_buffer: callers that cache objects on
+// the names, such as cg_vao_cache, must call invalidate_buffer() with the old names
+struct cg_shared_buffers
+{
+	struct range { size_t first_vertex=0, vertex_count=0, first_index=0, index_count=0; bool live=false; };
+
+	GLuint				vertex_buffer = 0;
+	GLuint				index_buffer = 0;
+	size_t				vertex_stride = sizeof(vertex);	// or sizeof(packed_vertex)
+	cg_range_allocator	vertices, indices;				// in bytes
+	std::vector<range>	ranges;							// indexed by the ids from add()
+	std::vector<int>	free_ids;
+
+	~cg_shared_buffers(){ release(); }
+
+	static bool supported(){ return glCopyBufferSubData&&glDrawElementsBaseVertex; }
+
+	bool init( size_t vertex_capacity, size_t index_capacity, size_t stride=sizeof(vertex) )
+	{
+		release(); if(!supported()){ printf( "[error] cg_shared_buffers: copy buffer and base-vertex draws are not supported\n" ); return false; }
+		vertex_stride = stride;
+		vertices.reset( vertex_capacity*stride ); indices.reset( index_capacity*sizeof(uint) );
+		vertex_buffer = resize_buffer( GL_ARRAY_BUFFER, 0, 0, vertices.capacity );
+		index_buffer = resize_buffer( GL_ELEMENT_ARRAY_BUFFER, 0, 0, indices.capacity );
+		return true;
+	}
+
+	// uploads a mesh with indices relative to its own vertices; returns its id, or -1. may replace the buffer names
+	int add( const void* vertex_data, size_t vertex_count, const uint* index_data=nullptr, size_t index_count=0 )
+	{
+		if(!vertex_buffer||!vertex_count) return -1;
+		size_t vb=vertex_count*vertex_stride, ib=index_count*sizeof(uint);
+		size_t vo=vertices.alloc( vb, vertex_stride );
+		if(vo==SIZE_MAX){ grow( vertex_buffer, vertices, GL_ARRAY_BUFFER, vb ); vo=vertices.alloc( vb, vertex_stride ); }
+		size_t io=0;
+		if(ib){ io=indices.alloc( ib, sizeof(uint) ); if(io==SIZE_MAX){ grow( index_buffer, indices, GL_ELEMENT_ARRAY_BUFFER, ib ); io=indices.alloc( ib, sizeof(uint) ); } }
+		if(vo==SIZE_MAX||io==SIZE_MAX){ if(vo!=SIZE_MAX) vertices.free( vo, vb ); if(ib&&io!=SIZE_MAX) indices.free( io, ib ); return -1; }
+
+		glBindBuffer( GL_ARRAY_BUFFER, vertex_buffer );
+		glBufferSubData( GL_ARRAY_BUFFER, GLintptr(vo), GLsizeiptr(vb), vertex_data );
+		if(ib){ glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, index_buffer ); glBufferSubData( GL_ELEMENT_ARRAY_BUFFER, GLintptr(io), GLsizeiptr(ib), index_data ); }
+
+		int id; if(free_ids.empty()){ id=int(ranges.size()); ranges.emplace_back(); } else { id=free_ids.back(); free_ids.pop_back(); }
+		range& r=ranges[id]; r.first_vertex=vo/vertex_stride; r.vertex_count=vertex_count; r.first_index=io/sizeof(uint); r.index_count=index_count; r.live=true;
+		return id;
+	}
+
+	// a mesh with host geometry (vertex_list/index_list, or pooled vertices/indices); host copies are unpacked
+	int add( const mesh& m )
+	{
+		if(vertex_stride!=sizeof(vertex)) return -1;
+		if(m.pooled) return add( m.vertices, m.vertices?m.vertex_count:0, m.indices, m.indices?m.index_count:0 );
+		if(m.vertex_list.empty()) return -1;
+		return add( &m.vertex_list[0], m.vertex_list.size(), m.index_list.empty()?nullptr:&m.index_list[0], m.index_list.size() );
+	}
+
+	void remove( int id )
+	{
+		if(id<0||id>=int(ranges.size())||!ranges[id].live) return;
+		range& r=ranges[id];
+		vertices.free( r.first_vertex*vertex_stride, r.vertex_count*vertex_stride );
+		indices.free( r.first_index*sizeof(uint), r.index_count*sizeof(uint) );
+		r=range(); free_ids.push_back(id);
+	}
+
+	// packs live meshes to the front of fresh buffers of the same capacity; ids stay valid, buffer names do not
+	void defragment()
+	{
+		if(!vertex_buffer) return;
+		std::vector<int> order; for( int k=0; k<int(ranges.size()); k++ ) if(ranges[k].live) order.push_back(k);
+		GLuint nb[2]={ resize_buffer( GL_ARRAY_BUFFER, 0, 0, vertices.capacity ), resize_buffer( GL_ELEMENT_ARRAY_BUFFER, 0, 0, indices.capacity ) };
+		size_t end[2]={0,0};
+		for( int s=0; s<2; s++ )
+		{
+			auto first=[&]( range& r )->size_t& { return s==0?r.first_vertex:r.first_index; };
+			auto count=[&]( range& r ){ return s==0?r.vertex_count:r.index_count; };
+			const size_t unit = s==0 ? vertex_stride : sizeof(uint);
+			std::sort( order.begin(), order.end(), [&]( int a, int b ){ return first(ranges[a])<first(ranges[b]); } );
+			glBindBuffer( GL_COPY_READ_BUFFER, s==0?vertex_buffer:index_buffer ); glBindBuffer( GL_COPY_WRITE_BUFFER, nb[s] );
+			for( int k : order )
+			{
+				range& r=ranges[k]; size_t n=count(r)*unit; if(!n) continue;
+				glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GLintptr(first(r)*unit), GLintptr(end[s]), GLsizeiptr(n) );
+				first(r)=end[s]/unit; end[s]+=n;
+			}
+		}
+		glDeleteBuffers( 1, &vertex_buffer ); vertex_buffer=nb[0];
+		glDeleteBuffers( 1, &index_buffer ); index_buffer=nb[1];
+		vertices.free_ranges.clear(); if(end[0]<vertices.capacity) vertices.free_ranges[end[0]]=vertices.capacity-end[0];
+		indices.free_ranges.clear(); if(end[1]<indices.capacity) indices.free_ranges[end[1]]=indices.capacity-end[1];
+	}
+
+	// bind once per scene, then set the vertex attribute pointers with vertex_stride and offsets from 0
+	void bind() const { glBindBuffer( GL_ARRAY_BUFFER, vertex_buffer ); glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, index_buffer ); }
+
+	void draw( int id, GLenum mode=GL_TRIANGLES ) const
+	{
+		const range& r=ranges[id];
+		if(r.index_count) glDrawElementsBaseVertex( mode, GLsizei(r.index_count), GL_UNSIGNED_INT, (GLvoid*)(r.first_index*sizeof(uint)), GLint(r.first_vertex) );
+		else glDrawArrays( mode, GLint(r.first_vertex), GLsizei(r.vertex_count) );
+	}
+
+	void release()
+	{
+		if(vertex_buffer) glDeleteBuffers( 1, &vertex_buffer );
+		if(index_buffer) glDeleteBuffers( 1, &index_buffer );
+		vertex_buffer = index_buffer = 0;
+		vertices.reset(0); indices.reset(0); ranges.clear(); free_ids.clear();
+	}
+
+	// creates a buffer of new_size and copies the first old_size bytes of buffer (deleted) into it
+	static GLuint resize_buffer( GLenum target, GLuint buffer, size_t old_size, size_t new_size )
+	{
+		GLuint b=0; glGenBuffers( 1, &b );
+		glBindBuffer( target, b ); glBufferData( target, GLsizeiptr(new_size), nullptr, GL_STATIC_DRAW );
+		if(!buffer) return b;
+		glBindBuffer( GL_COPY_READ_BUFFER, buffer ); glBindBuffer( GL_COPY_WRITE_BUFFER, b );
+		if(old_size) glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, GLsizeiptr(old_size) );
+		glDeleteBuffers( 1, &buffer );
+		return b;
+	}
+
+	void grow( GLuint& buffer, cg_range_allocator& a, GLenum target, size_t request )
+	{
+		size_t size = a.capacity*2>a.capacity+request ? a.capacity*2 : a.capacity+request;
+		buffer = resize_buffer( target, buffer, a.capacity, size );
+		a.grow(size);
+	}
+};
+
+//*******************************************************************
+// multi-draw indirect batching (GL 4.3 or ARB_multi_draw_indirect): per-object draws of meshes packed in one
+// cg_shared_buffers are collected as indirect commands with a row each in a per-draw table, and submit()
+// issues them with one glMultiDrawElementsIndirect. baseInstance of command k is k, so the table, bound as
+// an instanced attribute (divisor 1), gives every draw its own row without gl_DrawID
+struct cg_draw_batch
+{
+	struct command { GLuint count, instance_count, first_index; GLint base_vertex; GLuint base_instance; };	// DrawElementsIndirectCommand
+
+	std::vector<command>	commands;
+	std::vector<float>		rows;				// row_size floats per command
+	size_t					row_size = 16;		// a column-major mat4 by default
+	cg_buffer				indirect_buffer, row_buffer;
+	GLuint					vao = 0;			// shared buffers, vertex format and row attribute of vao_program
+	GLuint					vao_program = 0, vao_buffers[2] = { 0, 0 };
+	const cg_vertex_format*	vao_format = nullptr;
+	size_t					submits = 0, draws = 0;
+
+	cg_draw_batch():indirect_buffer(GL_DRAW_INDIRECT_BUFFER),row_buffer(GL_ARRAY_BUFFER){}
+	~cg_draw_batch(){ release(); }
+	static bool supported(){ return glMultiDrawElementsIndirect&&glVertexAttribDivisor&&cg_vao_cache::supported(); }
+
+	void clear(){ commands.clear(); rows.clear(); }
+
+	// appends a draw of mesh id in shared with its per-draw row; meshes without indices are skipped
+	void add( const cg_shared_buffers& shared, int id, const float* row )
+	{
+		const cg_shared_buffers::range& r = shared.ranges[id]; if(!r.live||!r.index_count) return;
+		command c = { GLuint(r.index_count), 1, GLuint(r.first_index), GLint(r.first_vertex), GLuint(commands.size()) };
+		commands.push_back(c); rows.insert( rows.end(), row, row+row_size );
+	}
+
+	// draws every command with program, whose attrib input (e.g., a mat4 over four locations) reads the rows
+	void submit( GLuint program, const cg_shared_buffers& shared, const cg_vertex_format& format, const char* attrib, GLenum mode=GL_TRIANGLES )
+	{
+		if(commands.empty()) return;
+		row_buffer.upload( &rows[0], rows.size()*sizeof(float), GL_STREAM_DRAW );
+		indirect_buffer.upload( &commands[0], commands.size()*sizeof(command), GL_STREAM_DRAW );
+		if(vao&&vao_program==program&&vao_buffers[0]==shared.vertex_buffer&&vao_buffers[1]==shared.index_buffer&&vao_format==&format) glBindVertexArray( vao );
+		else
+		{
+			invalidate(); glGenVertexArrays( 1, &vao ); glBindVertexArray( vao );
+			cg_bind_vertex_format( program, shared.vertex_buffer, format );
+			glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, shared.index_buffer );
+			GLint loc = glGetAttribLocation( program, attrib );
+			glBindBuffer( GL_ARRAY_BUFFER, row_buffer );
+			for( GLint c=0; loc>=0&&size_t(c*4)<row_size; c++ )
+			{
+				glEnableVertexAttribArray( GLuint(loc+c) );
+				glVertexAttribPointer( GLuint(loc+c), 4, GL_FLOAT, GL_FALSE, GLsizei(row_size*sizeof(float)), (GLvoid*)(c*4*sizeof(float)) );
+				glVertexAttribDivisor( GLuint(loc+c), 1 );
+			}
+			vao_program = program; vao_buffers[0] = shared.vertex_buffer; vao_buffers[1] = shared.index_buffer; vao_format = &format;
+		}
+		glBindBuffer( GL_DRAW_INDIRECT_BUFFER, indirect_buffer );
+		glMultiDrawElementsIndirect( mode, GL_UNSIGNED_INT, nullptr, GLsizei(commands.size()), 0 );
+		glBindVertexArray( 0 );
+		submits++; draws += commands.size();
+	}
+
+	// call when the program is deleted or relinked, or the shared buffers are replaced
+	void invalidate(){ if(vao) glDeleteVertexArrays( 1, &vao ); vao = vao_program = 0; }
+	void release(){ invalidate(); indirect_buffer.destroy(); row_buffer.destroy(); clear(); }
+};
+
+//*******************************************************************
+// sphere tessellation: the latitude/longitude grid of the app, shared with cgbench. cg_sphere_params is
+// the tessellation cache key (hashed as bytes, so it has no padding): bump CG_SPHERE_GENERATOR whenever
+// the generator below changes
+#define CG_SPHERE_GENERATOR	1
+struct cg_sphere_params { uint generator_version, N, topology, vertex_layout, fast_trig; float radius; };
+
+inline cg_sphere_params cg_sphere_key( uint N, float radius, bool fast_trig, bool packed )
+{
+	cg_sphere_params p = { CG_SPHERE_GENERATOR, N, 0 /* indexed triangles */, uint(packed?CG_LAYOUT_PACKED_VERTEX:CG_LAYOUT_VERTEX), fast_trig?1u:0u, radius };
+	return p;
+}
+
+// (N+1)*(2N+1) vertices; sines and cosines of the polar (alpha) and azimuthal (beta) angles take (N+1)+(2N+1) evaluations instead of per-vertex ones
+inline void cg_tessellate_sphere_vertices( uint N, float radius, bool fast_trig, std::vector<vertex>& vertices )
+{
+	vertices.clear();
+	vertices.reserve( size_t(N+1)*(N*2+1) );
+
+	std::vector<float> alpha(N+1), beta(N*2+1), sa(N+1), ca(N+1), sb(N*2+1), cb(N*2+1);
+	for( uint i=0; i<=N; i++ )		alpha[i] = PI*1.0f/float(N)*float(i);
+	for( uint k=0; k<=N*2; k++ )	beta[k] = PI*2.0f/float(N*2)*float(k);
+	if(fast_trig){ fast_sincos(&alpha[0],&sa[0],&ca[0],alpha.size()); fast_sincos(&beta[0],&sb[0],&cb[0],beta.size()); }
+	else
+	{
+		for( uint i=0; i<=N; i++ )		{ sa[i]=sin(alpha[i]); ca[i]=cos(alpha[i]); }
+		for( uint k=0; k<=N*2; k++ )	{ sb[k]=sin(beta[k]); cb[k]=cos(beta[k]); }
+	}
+
+	for( uint i=0; i<=N; i++ )
+		for( uint k=0; k<=N*2; k++ )
+			vertices.push_back({ vec3(radius*sa[i]*cb[k],radius*sa[i]*sb[k],radius*ca[i]), vec3(sa[i]*cb[k],sa[i]*sb[k],ca[i]), vec2(beta[k]/(2*PI),1-alpha[i]/PI) });
+}
+
+// two triangles per grid cell: N*(2N)*6 indices
+inline void cg_tessellate_sphere_indices( uint N, std::vector<uint>& indices )
+{
+	indices.clear();
+	indices.reserve( size_t(N)*(N*2)*6 );
+	for( uint i=0; i<N; i++ )
+		for( uint k=0; k<N*2; k++ )
+		{
+			uint a=(N*2+1)*i+k, b=a+N*2+1;
+			uint t[6] = { a+1, b, b+1, b, a+1, a };
+			indices.insert( indices.end(), t, t+6 );
+		}
+}
+
+inline void cg_tessellate_sphere( uint N, float radius, bool fast_trig, std::vector<vertex>& vertices, std::vector<uint>& indices )
+{
+	cg_tessellate_sphere_vertices( N, radius, fast_trig, vertices );
+	cg_tessellate_sphere_indices( N, indices );
+}
+
+//*******************************************************************
+// tessellation cache: generated geometry is stored as mesh containers under <cache_dir>/<key>.cgmesh,
+// where the key hashes the generator parameters (a struct without padding) and CG_MESH_VERSION
+inline std::string cg_tessellation_cache_path( const char* cache_dir, const void* params, size_t size )
+{
+	uint version=CG_MESH_VERSION, key[2] = { cg_fnv1a( params, size, cg_fnv1a(&version,sizeof(version)) ), cg_fnv1a( params, size, 0x6b43a9b5u ) };
+	char name[32]; snprintf( name, sizeof(name), "/%08x%08x.cgmesh", key[0], key[1] );
+	return std::string(cache_dir)+name;
+}
+
+// a hit maps the container and copies the sections into the host lists; a missing entry fails silently
+inline bool cg_load_tessellation( const char* path, std::vector<vertex>& vertices, std::vector<uint>& indices )
+{
+	FILE* fp = fopen( path, "rb" ); if(!fp) return false; fclose(fp);
+	mmap_t m = cg_map_binary(path); if(!m.ptr) return false;
+	const mesh_header* h = cg_validate_mesh_header( m, path );
+	bool b = h&&h->codec==CG_CODEC_NONE;
+	if(b) cg_copy_mesh_sections( *h, m.ptr+h->vertex_offset, m.ptr+h->index_offset, vertices, indices );
+	cg_unmap_binary(m);
+	return b;
+}
+
+// packed selects the stored vertex layout; it should be part of the key
+inline bool cg_save_tessellation( const char* cache_dir, const char* path, const std::vector<vertex>& vertices, const std::vector<uint>& indices, bool packed=false )
+{
+#ifdef _WIN32
+	_mkdir( cache_dir );
+#else
+	mkdir( cache_dir, 0755 );
+#endif
+	return cg_save_mesh_file( path, vertices, indices, packed );
+}
+
+//*******************************************************************
+// mesh import: OBJ and PLY (ascii, binary_little_endian, binary_big_endian) into vertex/index lists.
+// the source is mapped and its body is split at line boundaries across threads; threads=0 uses all cores
+
+template <class F> inline void cg_parallel_for( size_t n, int threads, F func )
+{
+	if(threads<=0) threads = int(std::thread::hardware_concurrency());
+	if(threads<=0) threads = 1;
+	if(threads==1||n<=1){ for( size_t k=0; k<n; k++ ) func(k); return; }
+	std::atomic<size_t> next(0); std::vector<std::thread> pool;
+	for( size_t t=0, tn=size_t(threads)<n?size_t(threads):n; t<tn; t++ ) pool.emplace_back( [&](){ for( size_t k; (k=next++)<n; ) func(k); } );
+	for( auto& t : pool ) t.join();
+}
+
+// returns parts+1 bounds; each inner bound follows a newline
+inline std::vector<const char*> cg_split_lines( const char* begin, const char* end, size_t parts )
+{
+	std::vector<const char*> b(1,begin);
+	for( size_t k=1; k<parts; k++ )
+	{
+		const char* p = begin+(end-begin)*k/parts; if(p<b.back()) p=b.back();
+		const char* q = p<end ? (const char*) memchr( p, '\n', end-p ) : nullptr;
+		b.push_back( q ? q+1 : end );
+	}
+	b.push_back(end);
+	return b;
+}
+
+// decimal digits accumulate in 64 bits (19 significant digits) and are scaled by exact powers of ten;
+// returns nullptr if no digits are found
+inline const char* cg_parse_float( const char* p, const char* end, float& value )
+{
+	static const double p10[] = { 1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22 };
+	while(p<end&&(*p==' '||*p=='\t')) p++;
+	bool neg=false; if(p<end&&(*p=='-'||*p=='+')) neg=*p++=='-';
+	uint64_t m=0; int e=0, digits=0; bool any=false;
+	for( ; p<end&&uint(*p-'0')<10; p++, any=true ){ if(digits<19){ m=m*10+uint(*p-'0'); if(m) digits++; } else e++; }
+	if(p<end&&*p=='.') for( p++; p<end&&uint(*p-'0')<10; p++, any=true ) if(digits<19){ m=m*10+uint(*p-'0'); if(m) digits++; e--; }
+	if(!any) return nullptr;
+	if(p<end&&(*p=='e'||*p=='E'))
+	{
+		const char* q=p+1; bool en=false; if(q<end&&(*q=='-'||*q=='+')) en=*q++=='-';
+		int x=0; const char* qs=q; for( ; q<end&&uint(*q-'0')<10; q++ ) if(x<10000) x=x*10+(*q-'0');
+		if(q>qs){ e+=en?-x:x; p=q; }
+	}
+	double d=double(m);
+	if(e<0){ for( ; e<-22; e+=22 ) d/=1e22; d/=p10[-e]; }
+	else { for( ; e>22; e-=22 ) d*=1e22; d*=p10[e]; }
+	value = float(neg?-d:d);
+	return p;
+}
+
+inline const char* cg_parse_int( const char* p, const char* end, int64_t& value )
+{
+	while(p<end&&(*p==' '||*p=='\t')) p++;
+	bool neg=false; if(p<end&&(*p=='-'||*p=='+')) neg=*p++=='-';
+	const char* s=p; int64_t v=0; for( ; p<end&&uint(*p-'0')<10; p++ ) v=v*10+(*p-'0');
+	if(p==s) return nullptr;
+	value = neg?-v:v;
+	return p;
+}
+
+inline const char* cg_next_line( const char* p, const char* end ){ p=(const char*) memchr( p, '\n', end-p ); return p?p+1:end; }
+
+// OBJ: v/vt/vn/f are parsed per chunk; polygons are fan-triangulated. face indices are stored as
+// (v,vt,vn) triples: >0 is the absolute 1-based index, 0 is absent, and <0 is a negative (relative)
+// index resolved against the chunk-local count as local+base-2^30, so chunks parse independently
+struct obj_chunk
+{
+	std::vector<vec3>	v, vn;
+	std::vector<vec2>	vt;
+	std::vector<int>	corners;
+	const char*			error = nullptr;	// first malformed line
+};
+
+inline void cg_parse_obj_chunk( const char* p, const char* end, obj_chunk& c )
+{
+	static const int rel = 1<<30;
+	while(p<end)
+	{
+		const char* line=p; p=cg_next_line(p,end);
+		const char* s=line; while(s<p&&(*s==' '||*s=='\t')) s++;
+		if(p-s<2||s[1]=='\n'||s[1]=='\r') continue;
+		if(s[0]=='v')
+		{
+			float f[3]={};
+			if(s[1]==' '||s[1]=='\t'){ s++; for( int k=0; k<3; k++ ) if(!(s=cg_parse_float(s,p,f[k]))){ c.error=line; return; } c.v.push_back(vec3(f[0],f[1],f[2])); }
+			else if(s[1]=='n'){ s+=2; for( int k=0; k<3; k++ ) if(!(s=cg_parse_float(s,p,f[k]))){ c.error=line; return; } c.vn.push_back(vec3(f[0],f[1],f[2])); }
+			else if(s[1]=='t'){ s+=2; for( int k=0; k<2; k++ ) if(!(s=cg_parse_float(s,p,f[k]))){ c.error=line; return; } c.vt.push_back(vec2(f[0],f[1])); }
+		}
+		else if(s[0]=='f'&&(s[1]==' '||s[1]=='\t'))
+		{
+			int n=0, first[3], prev[3];
+			for( s++;; n++ )
+			{
+				int64_t x; int idx[3]={}; int count[3]={int(c.v.size()),int(c.vt.size()),int(c.vn.size())};
+				const char* q=cg_parse_int(s,p,x); if(!q) break;
+				for( int k=0;; )
+				{
+					if(x==0){ c.error=line; return; }
+					idx[k] = x>0 ? int(x) : int(count[k]+x)-rel;
+					if(++k==3||q>=p||*q!='/') break;
+					q++; if(q<p&&*q=='/'){ q++; k++; }
+					if(!(q=cg_parse_int(q,p,x))){ if(k==1){ c.error=line; return; } break; }
+				}
+				s=q;
+				if(n==0) memcpy(first,idx,sizeof(idx));
+				else if(n>=2){ c.corners.insert(c.corners.end(),first,first+3); c.corners.insert(c.corners.end(),prev,prev+3); c.corners.insert(c.corners.end(),idx,idx+3); }
+				memcpy(prev,idx,sizeof(idx));
+			}
+			if(n<3){ c.error=line; return; }
+		}
+	}
+}
+
+inline bool cg_import_obj( const char* path, const char* begin, const char* end, std::vector<vertex>& vertices, std::vector<uint>& indices, int threads )
+{
+	size_t tn = threads>0 ? size_t(threads) : size_t(std::thread::hardware_concurrency());
+	std::vector<const char*> b = cg_split_lines( begin, end, (tn?tn:1)*4 );
+	std::vector<obj_chunk> chunks(b.size()-1);
+	cg_parallel_for( chunks.size(), threads, [&]( size_t k ){ cg_parse_obj_chunk( b[k], b[k+1], chunks[k] ); } );
+
+	// concatenate attributes; chunk bases resolve the relative indices
+	std::vector<vec3> v, vn; std::vector<vec2> vt; std::vector<int> base(chunks.size()*3);
+	size_t nv=0, nt=0, nn=0, nc=0;
+	for( size_t k=0; k<chunks.size(); k++ )
+	{
+		if(chunks[k].error){ const char* e=chunks[k].error; printf( "[error] %s: malformed line \"%.*s\"\n", path, int(cg_next_line(e,end)-e-1), e ); return false; }
+		base[k*3+0]=int(nv); base[k*3+1]=int(nt); base[k*3+2]=int(nn);
+		nv+=chunks[k].v.size(); nt+=chunks[k].vt.size(); nn+=chunks[k].vn.size(); nc+=chunks[k].corners.size()/3;
+	}
+	if(nv>=(1u<<30)||nc>=(1u<<31)){ printf( "[error] %s: too many elements\n", path ); return false; }
+	v.reserve(nv); vt.reserve(nt); vn.reserve(nn);
+	for( auto& c : chunks ){ v.insert(v.end(),c.v.begin(),c.v.end()); vt.insert(vt.end(),c.vt.begin(),c.vt.end()); vn.insert(vn.end(),c.vn.begin(),c.vn.end()); std::vector<vec3>().swap(c.v); std::vector<vec2>().swap(c.vt); std::vector<vec3>().swap(c.vn); }
+
+	// deduplicate (v,vt,vn) triples with an open-addressing table; absent attributes are -1
+	size_t cap=64; while(cap<nc*2) cap<<=1;
+	std::vector<uint> table(cap,0xffffffffu); std::vector<int> keys; keys.reserve(nc);
+	vertices.clear(); indices.clear(); indices.reserve(nc);
+	for( size_t k=0; k<chunks.size(); k++ )
+	{
+		const int* c=chunks[k].corners.data(); const size_t n=chunks[k].corners.size(); const int* bk=&base[k*3];
+		for( size_t j=0; j<n; j+=3 )
+		{
+			int key[3]; const size_t count[3]={nv,nt,nn};
+			for( int i=0; i<3; i++ )
+			{
+				int64_t x = c[j+i]>0 ? int64_t(c[j+i])-1 : c[j+i]<0 ? int64_t(c[j+i])+(1<<30)+bk[i] : -1;
+				if(x>=int64_t(count[i])||(x<0&&(i==0||c[j+i]!=0))){ printf( "[error] %s: face index out of range\n", path ); return false; }
+				key[i]=int(x);
+			}
+			uint h = (uint(key[0])*0x9e3779b1u)^(uint(key[1])*0x85ebca77u)^(uint(key[2])*0xc2b2ae3du); h^=h>>15;
+			size_t slot=h&(cap-1);
+			for( ; table[slot]!=0xffffffffu; slot=(slot+1)&(cap-1) ){ const int* o=&keys[size_t(table[slot])*3]; if(o[0]==key[0]&&o[1]==key[1]&&o[2]==key[2]) break; }
+			if(table[slot]==0xffffffffu)
+			{
+				table[slot]=uint(vertices.size()); keys.insert(keys.end(),key,key+3);
+				vertex t; t.pos=v[key[0]]; t.norm=key[2]<0?vec3(0,0,0):vn[key[2]]; t.tex=key[1]<0?vec2(0,0):vt[key[1]];
+				vertices.push_back(t);
+			}
+			indices.push_back(table[slot]);
+		}
+		std::vector<int>().swap(chunks[k].corners);
+	}
+	return true;
+}
+
+// PLY: the header describes elements of scalar or list properties; vertex (x,y,z,nx,ny,nz,u|s,v|t)
+// and face (vertex_indices|vertex_index) are imported and other elements are skipped
+struct ply_property { std::string name; int type=0, count_type=0; bool list=false; };
+struct ply_element { std::string name; size_t count=0; std::vector<ply_property> props; };
+
+inline int cg_ply_type( const std::string& s ) // size in bytes, negative for signed integers, 16+size for floats
+{
+	if(s=="char"||s=="int8") return -1;
+	if(s=="uchar"||s=="uint8") return 1;
+	if(s=="short"||s=="int16") return -2;
+	if(s=="ushort"||s=="uint16") return 2;
+	if(s=="int"||s=="int32") return -4;
+	if(s=="uint"||s=="uint32") return 4;
+	if(s=="float"||s=="float32") return 20;
+	if(s=="double"||s=="float64") return 24;
+	return 0;
+}
+
+inline double cg_ply_read( const char* p, int type, bool swap )
+{
+	uchar b[8]; int size=type>16?type-16:type<0?-type:type;
+	for( int k=0; k<size; k++ ) b[k]=uchar(p[swap?size-1-k:k]);
+	switch(type)
+	{
+	case -1: return double(int8_t(b[0]));		case 1: return double(b[0]);
+	case -2: { int16_t x; memcpy(&x,b,2); return x; }	case 2: { uint16_t x; memcpy(&x,b,2); return x; }
+	case -4: { int32_t x; memcpy(&x,b,4); return x; }	case 4: { uint32_t x; memcpy(&x,b,4); return x; }
+	case 20: { float x; memcpy(&x,b,4); return x; }		case 24: { double x; memcpy(&x,b,8); return x; }
+	}
+	return 0;
+}
+
+inline bool cg_import_ply( const char* path, const char* begin, const char* end, std::vector<vertex>& vertices, std::vector<uint>& indices, int threads )
+{
+	// header
+	int format=-1; std::vector<ply_element> elements; const char* p=begin;
+	for( bool done=false; !done; )
+	{
+		if(p>=end){ printf( "[error] %s: no end_header\n", path ); return false; }
+		const char* e=cg_next_line(p,end); std::string line(p,e); p=e;
+		while(!line.empty()&&(line.back()=='\n'||line.back()=='\r')) line.pop_back();
+		char a[64]={}, t0[64]={}, t1[64]={}, t2[64]={}, t3[64]={};
+		int n=sscanf( line.c_str(), "%63s %63s %63s %63s %63s", a, t0, t1, t2, t3 );
+		std::string cmd=a;
+		if(cmd=="end_header") done=true;
+		else if(cmd=="format"&&n>=2) format=strcmp(t0,"ascii")==0?0:strcmp(t0,"binary_little_endian")==0?1:strcmp(t0,"binary_big_endian")==0?2:-1;
+		else if(cmd=="element"&&n==3){ ply_element el; el.name=t0; el.count=size_t(strtoull(t1,nullptr,10)); elements.push_back(el); }
+		else if(cmd=="property"&&!elements.empty())
+		{
+			ply_property pr;
+			if(strcmp(t0,"list")==0&&n==5){ pr.list=true; pr.count_type=cg_ply_type(t1); pr.type=cg_ply_type(t2); pr.name=t3; if(!pr.count_type||pr.count_type>16) pr.type=0; }
+			else if(n==3){ pr.type=cg_ply_type(t0); pr.name=t1; }
+			if(!pr.type){ printf( "[error] %s: unsupported property \"%s\"\n", path, line.c_str() ); return false; }
+			elements.back().props.push_back(pr);
+		}
+		else if(p==cg_next_line(begin,end)&&cmd!="ply"){ printf( "[error] %s: not a PLY file\n", path ); return false; }
+	}
+	if(format<0){ printf( "[error] %s: unsupported PLY format\n", path ); return false; }
+
+	// vertex and face property slots
+	static const char* names[8][3] = { {"x"},{"y"},{"z"},{"nx"},{"ny"},{"nz"},{"u","s","texture_u"},{"v","t","texture_v"} };
+	size_t nv=0; std::vector<int> vslot; int fslot=-1; // vslot: vertex property -> pos.xyz, norm.xyz, tex.xy (0..7) or -1
+	for( auto& el : elements )
+	{
+		if(el.name=="vertex")
+		{
+			nv=el.count; vslot.assign(el.props.size(),-1); int found=0;
+			for( size_t j=0; j<el.props.size(); j++ ) for( int k=0; k<8; k++ ) for( int i=0; i<3; i++ ) if(names[k][i]&&el.props[j].name==names[k][i]&&!el.props[j].list){ vslot[j]=k; if(k<3) found|=1<<k; }
+			if(found!=7){ printf( "[error] %s: vertex without x, y, z\n", path ); return false; }
+		}
+		if(el.name=="face") for( size_t j=0; j<el.props.size(); j++ ) if(el.props[j].list&&(el.props[j].name=="vertex_indices"||el.props[j].name=="vertex_index")) fslot=int(j);
+	}
+	vertices.assign( nv, vertex() ); indices.clear();
+	for( auto& v : vertices ){ v.norm=vec3(0,0,0); v.tex=vec2(0,0); }
+	auto set_vertex = [&]( vertex& v, int j, float f ){ int k=vslot[j]; if(k<0) return; if(k<3) v.pos[k]=f; else if(k<6) v.norm[k-3]=f; else v.tex[k-6]=f; };
+	auto add_face = [&]( std::vector<uint>& dst, const int64_t* idx, size_t n ) -> bool
+	{
+		for( size_t k=0; k<n; k++ ) if(idx[k]<0||uint64_t(idx[k])>=nv) return false;
+		for( size_t k=2; k<n; k++ ){ dst.push_back(uint(idx[0])); dst.push_back(uint(idx[k-1])); dst.push_back(uint(idx[k])); }
+		return true;
+	};
+
+	if(format==0)
+	{
+		// count lines per chunk in parallel, then parse each chunk knowing its first line number
+		size_t tn = threads>0 ? size_t(threads) : size_t(std::thread::hardware_concurrency());
+		std::vector<const char*> b = cg_split_lines( p, end, (tn?tn:1)*4 );
+		size_t nc=b.size()-1; std::vector<size_t> lines(nc+1,0); std::vector<std::vector<uint>> faces(nc); std::vector<const char*> errors(nc,nullptr);
+		cg_parallel_for( nc, threads, [&]( size_t k ){ for( const char* q=b[k]; q<b[k+1]&&(q=(const char*)memchr(q,'\n',b[k+1]-q)); q++ ) lines[k+1]++; if(b[k+1]==end&&b[k+1]>b[k]&&end[-1]!='\n') lines[k+1]++; } );
+		for( size_t k=0; k<nc; k++ ) lines[k+1]+=lines[k];
+		cg_parallel_for( nc, threads, [&]( size_t k )
+		{
+			size_t line=lines[k], first=0; size_t ei=0; while(ei<elements.size()&&line>=first+elements[ei].count) first+=elements[ei++].count;
+			std::vector<int64_t> idx;
+			for( const char *q=b[k], *qe, *ls; q<b[k+1]&&ei<elements.size(); q=qe, line++ )
+			{
+				ls=q; qe=cg_next_line(q,b[k+1]);
+				while(ei<elements.size()&&line>=first+elements[ei].count) first+=elements[ei++].count;
+				if(ei>=elements.size()) break;
+				const ply_element& el=elements[ei];
+				if(el.name=="vertex")
+				{
+					vertex& v=vertices[line-first];
+					for( int j=0; j<int(el.props.size()); j++ )
+					{
+						if(el.props[j].list){ int64_t c; if(!(q=cg_parse_int(q,qe,c))) break; float f; for( int64_t i=0; i<c&&q; i++ ) q=cg_parse_float(q,qe,f); if(!q) break; continue; }
+						float f; if(!(q=cg_parse_float(q,qe,f))) break; set_vertex(v,j,f);
+					}
+				}
+				else if(el.name=="face")
+				{
+					for( int j=0; j<int(el.props.size())&&q; j++ )
+					{
+						int64_t c; if(!el.props[j].list){ float f; q=cg_parse_float(q,qe,f); continue; }
+						if(!(q=cg_parse_int(q,qe,c))||c<0||c>qe-q) { q=nullptr; break; }	// an index takes at least a character
+						idx.resize(size_t(c)); for( int64_t i=0; i<c&&q; i++ ) q=cg_parse_int(q,qe,idx[size_t(i)]);
+						if(q&&j==fslot&&!add_face(faces[k],idx.data(),idx.size())) q=nullptr;
+					}
+				}
+				if(!q){ errors[k]=ls; break; }
+			}
+		} );
+		for( size_t k=0; k<nc; k++ ) if(errors[k]){ const char* e=errors[k]; printf( "[error] %s: malformed line \"%.*s\"\n", path, int(cg_next_line(e,end)-e-1), e ); return false; }
+		size_t total=0; for( auto& el : elements ) total+=el.count;
+		if(lines[nc]<total){ printf( "[error] %s: truncated\n", path ); return false; }
+		size_t ni=0; for( auto& f : faces ) ni+=f.size(); indices.reserve(ni);
+		for( auto& f : faces ){ indices.insert(indices.end(),f.begin(),f.end()); std::vector<uint>().swap(f); }
+		return true;
+	}
+
+	// binary: fixed-size elements are split across threads by record; list elements are walked in order
+	const bool swap = format==2; const char* q=p;
+	auto size_of = []( int type ){ return size_t(type>16?type-16:type<0?-type:type); };
+	std::vector<int64_t> idx;
+	for( auto& el : elements )
+	{
+		bool fixed=true; size_t stride=0; std::vector<size_t> offset;
+		for( auto& pr : el.props ){ offset.push_back(stride); if(pr.list) fixed=false; else stride+=size_of(pr.type); }
+		if(fixed)
+		{
+			if(size_t(end-q)/(stride?stride:1)<el.count){ printf( "[error] %s: truncated\n", path ); return false; }
+			if(el.name=="vertex")
+			{
+				size_t block=65536;
+				cg_parallel_for( (el.count+block-1)/block, threads, [&]( size_t k )
+				{
+					for( size_t i=k*block, in=i+block<el.count?i+block:el.count; i<in; i++ )
+						for( int j=0; j<int(el.props.size()); j++ ) set_vertex( vertices[i], j, float(cg_ply_read(q+i*stride+offset[j],el.props[j].type,swap)) );
+				} );
+			}
+			q+=stride*el.count;
+			continue;
+		}
+		for( size_t i=0; i<el.count; i++ )
+		{
+			for( int j=0; j<int(el.props.size()); j++ )
+			{
+				const ply_property& pr=el.props[j];
+				size_t cs=pr.list?size_of(pr.count_type):0, is=size_of(pr.type);
+				if(size_t(end-q)<cs+is){ printf( "[error] %s: truncated\n", path ); return false; }
+				if(!pr.list){ if(el.name=="vertex") set_vertex( vertices[i], j, float(cg_ply_read(q,pr.type,swap)) ); q+=is; continue; }
+				int64_t c=int64_t(cg_ply_read(q,pr.count_type,swap)); q+=cs;
+				if(c<0||size_t(end-q)/is<size_t(c)){ printf( "[error] %s: truncated\n", path ); return false; }
+				if(el.name=="face"&&j==fslot)
+				{
+					idx.resize(size_t(c)); for( int64_t k=0; k<c; k++ ) idx[size_t(k)]=int64_t(cg_ply_read(q+k*is,pr.type,swap));
+					if(!add_face(indices,idx.data(),idx.size())){ printf( "[error] %s: face index out of range\n", path ); return false; }
+				}
+				q+=is*size_t(c);
+			}
+		}
+	}
+	return true;
+}
+
+// imports .obj or .ply by extension into vertex/index lists ready for cg_save_mesh_file()
+inline bool cg_import_mesh( const char* path, std::vector<vertex>& vertices, std::vector<uint>& indices, int threads=0 )
+{
+	std::string ext = strrchr( path, '.' ) ? strrchr( path, '.' ) : ""; for( auto& c : ext ) c=char(tolower(c));
+	bool obj = ext==".obj", ply = ext==".ply";
+	if(!obj&&!ply){ printf( "[error] %s: unknown mesh format\n", path ); return false; }
+	mmap_t m = cg_map_binary( path ); if(!m.ptr){ if(!m.size) printf( "[error] %s: empty file\n", path ); return false; }
+	bool b = obj ? cg_import_obj( path, m.ptr, m.ptr+m.size, vertices, indices, threads ) : cg_import_ply( path, m.ptr, m.ptr+m.size, vertices, indices, threads );
+	cg_unmap_binary(m);
+	if(!b){ vertices.clear(); indices.clear(); }
+	return b;
+}
+
+//*******************************************************************
+// asynchronous mesh loading: a worker thread reads and uploads meshes in a hidden
+// window whose context shares objects with the render context
+struct cg_mesh_request
+{
+	std::string			path;
+	bool				keep_host_copy = true;
+	size_t				stream_chunk = 0;
+	std::atomic<int>	state;				// 0: pending, 1: uploaded, -1: failed
+	mesh*				result = nullptr;
+	GLsync				fence = nullptr;	// signaled when the worker's uploads complete on the GPU
+
+	cg_mesh_request():state(0){}
+	bool failed() const { return state.load()<0; }
+	bool ready() // poll on the render thread; result is usable once this returns true
+	{
+		if(state.load()!=1) return false;
+		if(fence){ GLenum r=glClientWaitSync(fence,0,0); if(r!=GL_ALREADY_SIGNALED&&r!=GL_CONDITION_SATISFIED) return false; glDeleteSync(fence); fence=nullptr; }
+		return true;
+	}
+	bool wait() // blocks until the uploads complete, e.g. at shutdown; false if the request failed or is still pending
+	{
+		if(state.load()!=1) return false;
+		if(fence){ while( glClientWaitSync(fence,GL_SYNC_FLUSH_COMMANDS_BIT,1000000)==GL_TIMEOUT_EXPIRED ); glDeleteSync(fence); fence=nullptr; }
+		return true;
+	}
+};
+typedef std::shared_ptr<cg_mesh_request> cg_mesh_handle;
+
+struct cg_mesh_loader
+{
+	GLFWwindow*					context = nullptr;
+	std::thread					worker;
+	std::mutex					mutex;
+	std::condition_variable		cv;
+	std::deque<cg_mesh_handle>	queue;
+	bool						quit = false;
+
+	~cg_mesh_loader(){ stop(); }
+
+	// call on the main thread after the render context is created
+	bool start( GLFWwindow* share )
+	{
+		if(context) return true;
+		glfwWindowHint( GLFW_VISIBLE, GL_FALSE );
+		context = glfwCreateWindow( 1, 1, "loader", nullptr, share );
+		glfwWindowHint( GLFW_VISIBLE, GL_TRUE );	// GLFW's default, as cg_create_window() leaves it
+		if(!context){ printf( "[error] cg_mesh_loader: failed to create a shared context\n" ); return false; }
+		quit = false;
+		worker = std::thread( [this](){ run(); } );
+		return true;
+	}
+
+	// call on the main thread; pending requests fail
+	void stop()
+	{
+		if(!context) return;
+		{ std::lock_guard<std::mutex> lock(mutex); quit = true; }
+		cv.notify_all();
+		worker.join();
+		glfwDestroyWindow(context); context = nullptr;
+	}
+
+	cg_mesh_handle load( const char* path, bool keep_host_copy=true, size_t stream_chunk=0 )
+	{
+		cg_mesh_handle r = std::make_shared<cg_mesh_request>();
+		r->path = path; r->keep_host_copy = keep_host_copy; r->stream_chunk = stream_chunk;
+		if(!context){ r->state = -1; return r; }
+		{ std::lock_guard<std::mutex> lock(mutex); queue.push_back(r); }
+		cv.notify_one();
+		return r;
+	}
+
+	void run()
+	{
+		glfwMakeContextCurrent(context);
+		for(;;)
+		{
+			cg_mesh_handle r;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cv.wait( lock, [this](){ return quit||!queue.empty(); } );
+				if(quit) break;
+				r = queue.front(); queue.pop_front();
+			}
+			r->result = cg_load_mesh_file( r->path.c_str(), r->keep_host_copy, r->stream_chunk );
+			if(r->result&&glFenceSync){ r->fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 ); glFlush(); }
+			else if(r->result) glFinish();	// no ARB_sync: complete the uploads before publishing
+			r->state = r->result ? 1 : -1;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		for( auto& r : queue ) r->state = -1;
+		queue.clear();
+		glfwMakeContextCurrent(nullptr);
+	}
+};
+
+//*******************************************************************
+// frame statistics: rolling windows of per-phase CPU times and of GPU time stamps around the draws,
+// summarized as p50/p95/p99/max (nearest rank) or dumped per frame to a CSV file
+struct cg_rolling_stats
+{
+	std::vector<float>	samples;	// milliseconds in a ring; next is the oldest once count==window
+	size_t				next = 0, count = 0;
+
+	explicit cg_rolling_stats( size_t window=600 ):samples(window,0){}
+	void add( float ms ){ samples[next] = ms; next = (next+1)%samples.size(); if(count<samples.size()) count++; }
+	float at( size_t k ) const { return samples[(next+samples.size()-count+k)%samples.size()]; }	// k-th oldest
+
+	// q[4] = p50, p95, p99, max; zeros without samples
+	void summary( float q[4] ) const
+	{
+		q[0]=q[1]=q[2]=q[3]=0; if(!count) return;
+		std::vector<float> v( count ); for( size_t k=0; k<count; k++ ) v[k]=at(k);
+		std::sort( v.begin(), v.end() );
+		const float p[3] = { 0.50f, 0.95f, 0.99f };
+		for( int k=0; k<3; k++ ){ size_t r=size_t(ceil(p[k]*count)); q[k]=v[r>0?r-1:0]; }
+		q[3] = v.back();
+	}
+};
+
+// a ring of GL_TIMESTAMP pairs (GL 3.3 or ARB_timer_query): completed pairs are read in frame order without
+// stalling; a pair stays pending until its result is available, and only when the ring wraps onto an unfinished
+// pair (the GPU is more than ring frames behind) does begin() wait for it, so slow frames are never dropped
+struct cg_gpu_timer
+{
+	static const int	ring = 4;
+	GLuint				queries[ring][2] = {};
+	bool				pending[ring] = {};
+	int					slot = 0;				// the pair of the next frame; the oldest pending pair when the ring is full
+	size_t				stalls = 0;				// begin() calls that waited for a result
+	cg_rolling_stats	times;
+
+	~cg_gpu_timer(){ release(); }
+	static bool supported(){ return glQueryCounter&&glGetQueryObjectui64v&&glGenQueries; }
+
+	bool init(){ release(); if(!supported()) return false; glGenQueries( ring*2, &queries[0][0] ); return true; }
+	void begin()
+	{
+		if(!queries[0][0]) return;
+		for( int k=0; k<ring; k++ ) // oldest first, up to the first unfinished pair
+		{
+			int s=(slot+k)%ring; if(!pending[s]) continue;
+			GLint available=0; glGetQueryObjectiv( queries[s][1], GL_QUERY_RESULT_AVAILABLE, &available );
+			if(!available) break;
+			read(s);
+		}
+		if(pending[slot]){ stalls++; read(slot); } // GL_QUERY_RESULT waits
+		glQueryCounter( queries[slot][0], GL_TIMESTAMP );
+	}
+	size_t in_flight() const { size_t n=0; for( int k=0; k<ring; k++ ) n += pending[k]?1:0; return n; }	// frames without a time yet
+	void end(){ if(!queries[0][0]) return; glQueryCounter( queries[slot][1], GL_TIMESTAMP ); pending[slot] = true; slot = (slot+1)%ring; }
+	void release()
+	{
+		if(queries[0][0]) glDeleteQueries( ring*2, &queries[0][0] );
+		for( int k=0; k<ring; k++ ){ queries[k][0] = queries[k][1] = 0; pending[k] = false; }
+		slot = 0;
+	}
+
+	// adds the time of a finished pair, waiting for it otherwise
+	void read( int s )
+	{
+		GLuint64 t0=0, t1=0;
+		glGetQueryObjectui64v( queries[s][0], GL_QUERY_RESULT, &t0 );
+		glGetQueryObjectui64v( queries[s][1], GL_QUERY_RESULT, &t1 );
+		times.add( float(double(t1-t0)*1e-6) ); pending[s] = false;
+	}
+};
+
+struct cg_frame_stats
+{
+	std::vector<const char*>		names;		// CPU phases in frame order
+	std::vector<cg_rolling_stats>	phases;
+	cg_rolling_stats				frame;		// begin_frame() to end_frame()
+	double							t0 = 0, t = 0;
+
+	int add_phase( const char* name, size_t window=600 ){ names.push_back(name); phases.emplace_back(window); frame = cg_rolling_stats(window); return int(phases.size())-1; }
+	void begin_frame(){ t0 = t = glfwGetTime(); }
+	void lap( int phase ){ double n=glfwGetTime(); phases[phase].add( float((n-t)*1000.0) ); t = n; }	// time since the previous lap
+	void end_frame(){ frame.add( float((glfwGetTime()-t0)*1000.0) ); }
+
+	void print( const cg_gpu_timer* gpu=nullptr ) const
+	{
+		printf( "[frame statistics] last %zu frames, in ms\n", frame.count );
+		printf( "  %-10s %8s %8s %8s %8s\n", "phase", "p50", "p95", "p99", "max" );
+		float q[4];
+		for( size_t k=0; k<phases.size(); k++ ){ phases[k].summary(q); printf( "  %-10s %8.3f %8.3f %8.3f %8.3f\n", names[k], q[0], q[1], q[2], q[3] ); }
+		frame.summary(q); printf( "  %-10s %8.3f %8.3f %8.3f %8.3f\n", "frame", q[0], q[1], q[2], q[3] );
+		if(gpu&&gpu->times.count){ gpu->times.summary(q); printf( "  %-10s %8.3f %8.3f %8.3f %8.3f (%zu stalls)\n", "gpu draw", q[0], q[1], q[2], q[3], gpu->stalls ); }
+		printf( "\n" );
+	}
+
+	// one row per frame in the window, oldest first, numbered by its position in the window; gpu_draw is aligned
+	// to its frame, so the last rows, still in flight on the GPU (at most cg_gpu_timer::ring), have none
+	bool save_csv( const char* path, const cg_gpu_timer* gpu=nullptr ) const
+	{
+		FILE* fp = fopen( path, "w" ); if(fp==nullptr){ printf( "[error] unable to write %s\n", path ); return false; }
+		fprintf( fp, "index" ); for( const char* n : names ) fprintf( fp, ",%s", n ); fprintf( fp, ",total%s\n", gpu?",gpu_draw":"" );
+		for( size_t k=0; k<frame.count; k++ )
+		{
+			fprintf( fp, "%zu", k );
+			for( const auto& p : phases ){ if(k+p.count>=frame.count) fprintf( fp, ",%.4f", p.at(k+p.count-frame.count) ); else fprintf( fp, "," ); }
+			fprintf( fp, ",%.4f", frame.at(k) );
+			if(gpu){ size_t n=gpu->times.count, last=frame.count-min(gpu->in_flight(),frame.count); if(k<last&&k+n>=last) fprintf( fp, ",%.4f", gpu->times.at(k+n-last) ); else fprintf( fp, "," ); }
+			fprintf( fp, "\n" );
+		}
+		fclose(fp);
+		return true;
+	}
+};
+
 #endif // __CGUT_H__
\ No newline at end of file
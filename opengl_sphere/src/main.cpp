@@ -9,6 +9,10 @@
 static const char*	window_name = "cgbase - circle";
 static const char*	vert_shader_path = "../bin/shaders/circ.vert";
 static const char*	frag_shader_path = "../bin/shaders/circ.frag";
+static const char*	mesh_export_path = "../bin/sphere.cgmesh";
+static const char*	program_cache_dir = "../bin/shaders/cache";	// program binaries keyed by source and driver
+static const char*	tessellation_cache_dir = "../bin/cache";	// sphere geometry keyed by its generator parameters
+static const char*	frame_stats_path = "../bin/frame_stats.csv";	// per-frame phase times dumped with F3
 uint				NUM_TESS = 36;		// initial tessellation factor
 
 //*******************************************************************
@@ -19,8 +23,23 @@ ivec2		window_size = ivec2(1024, 576);	// initial window size
 //*******************************************************************
 // OpenGL objects
 GLuint	program = 0;	// ID holder for GPU program
-GLuint	vertex_buffer = 0;	// ID holder for vertex buffer
-GLuint	index_buffer = 0;	// ID holder for index buffer
+cg_buffer	vertex_buffer(GL_ARRAY_BUFFER);			// ID holder for vertex buffer; storage is reused across rebuilds
+cg_buffer	index_buffer(GL_ELEMENT_ARRAY_BUFFER);	// ID holder for index buffer
+cg_mesh_loader	loader;		// background mesh loading on a shared context
+cg_mesh_handle	mesh_request;	// pending background load
+mesh*			loaded_mesh = nullptr;	// drawn instead of the tessellated sphere once loaded
+cg_file_watcher		shader_watcher;		// reloads the program when the shader files change
+cg_async_program	program_reload;		// replacement program being compiled in the background
+cg_uniforms			uniforms;			// reflected uniforms of program with shadow copies
+cg_vao_cache		vaos;				// vertex array objects per (program, buffers, vertex format)
+cg_uniform_ring		uniform_ring;		// persistently mapped per-frame/per-object uniform blocks
+cg_shader_permutations	shader_variants;	// program variants per rotation/color mode; program is the current one
+cg_shared_buffers	grid_buffers;		// the sphere of the object grid, packed for batched draws
+cg_draw_batch		grid_batch;			// per-object draws of the grid as one multi-draw
+cg_frame_stats		frame_stats;		// rolling CPU times of the phases of a frame
+cg_gpu_timer		gpu_timer;			// rolling GPU times of the draws
+int		phase_poll = frame_stats.add_phase("poll"), phase_update = frame_stats.add_phase("update");
+int		phase_render = frame_stats.add_phase("render"), phase_swap = frame_stats.add_phase("swap");
 
 //*******************************************************************
 // global variables
@@ -31,43 +50,192 @@ float	radius = 1.0f;
 bool	bUseIndexBuffer = true;
 bool	bWireframe = false;
 bool    bRotation = false;   // this is the default
+bool	bFastTrig = false;		// use cgmath's fast_sincos() instead of libm sin/cos
+bool	bPackedVertices = false;	// upload packed_vertex (20 bytes) instead of vertex (32 bytes)
+bool	bReflectedUniforms = true;	// set uniforms through the reflected table instead of per-frame lookups
+size_t	uniform_calls = 0, uniform_frames = 0;	// uniform-related GL calls since the last 'u' toggle
+bool	bUseVAO = true;			// draw with cached VAOs instead of per-frame attribute setup
+double	draw_time = 0; size_t draw_count = 0;	// CPU time of attribute setup and draw calls since the last 'v' toggle
+bool	bUniformBlocks = false;	// uniform blocks written through uniform_ring (GL 4.4 or ARB_buffer_storage)
+const char*	shader_defines = nullptr;	// inserted after #version of both shaders
+bool	bObjectGrid = false;	// draw grid_size^2 small spheres instead of the single one
+bool	bBatchDraws = true;		// submit the grid with one multi-draw instead of a draw per object
+int		grid_mesh = -1;			// id of the grid's sphere in grid_buffers
+double	grid_time = 0; size_t grid_frames = 0;	// CPU time of the grid submission since the last 'm' toggle
+static const uint grid_size = 64;
+
+//*******************************************************************
+// host mirror of the std140 uniform block in circ.vert
+struct object_block { float model_view_projection[16]; };
+
+// binds the uniform block of a freshly linked program to the ring's binding point
+void bind_uniform_blocks(GLuint p)
+{
+	if (bUniformBlocks) cg_bind_uniform_block(p, "object_block", 0);
+}
+
+// shader permutations: the color mode in the low bits, and draw_batch_key for the batched-draw input;
+// the rotation is part of the model-view-projection matrix
+static const uint draw_batch_key = 4;
+uint shader_key() { return uint(solid_color); }
+std::string shader_variant_defines(uint key)
+{
+	char defines[64]; snprintf(defines, sizeof(defines), "#define SOLID_COLOR %u\n%s", key & 3, (key & draw_batch_key) ? "#define DRAW_BATCH\n" : "");
+	return defines;
+}
+
+// switches to the program of the current modes, compiling it on first use
+void select_program()
+{
+	GLuint p = shader_variants.get(shader_key());
+	if (!p || p == program) return;
+	program = p;
+	uniforms.reflect(program);
+}
+
+// fixed view-projection: looks down -x with z up
+mat4 view_projection_matrix =
+{
+	0, 1, 0, 0,
+	0, 0, 1, 0,
+   -1, 0, 0, 1,
+	0, 0, 0, 1
+};
+uint reload_key = 0;	// variant being recompiled in the background
+
+// concatenates model, radius scale, view-projection and aspect correction once per object on the CPU
+mat4 model_view_projection(const mat4& model_matrix, float aspect_ratio)
+{
+	mat4 aspect_correction = mat4::scale(aspect_ratio > 1 ? 1 / aspect_ratio : 1, aspect_ratio > 1 ? 1 : aspect_ratio, 1);
+	return aspect_correction * view_projection_matrix * model_matrix * mat4::scale(radius, radius, radius);
+}
 
 //*******************************************************************
 // holder of vertices and indices
 std::vector<vertex>	vertex_list;	// host-side vertices
 std::vector<uint>	index_list;		// host-side indices
 
+//*******************************************************************
+// packs a coarse sphere into grid_buffers on first use
+bool init_object_grid()
+{
+	if (grid_mesh >= 0) return true;
+	if (!grid_buffers.init(1 << 12, 1 << 12)) return false;
+	mesh sphere;	// coarse: the grid is about submission cost, not vertex work; generated directly, bypassing the cache and the interactive sphere
+	cg_tessellate_sphere(8, radius, bFastTrig, sphere.vertex_list, sphere.index_list);
+	grid_mesh = grid_buffers.add(sphere);
+	return grid_mesh >= 0;
+}
+
+// draws the grid: per-object rows collected into grid_batch and one multi-draw, or per object a uniform
+// (or uniform ring range) update and a draw
+void render_object_grid()
+{
+	if (grid_mesh < 0) return;
+	double t0 = glfwGetTime();
+	const bool batch = bBatchDraws && cg_draw_batch::supported();
+	GLuint p = batch ? shader_variants.get(shader_key() | draw_batch_key) : program; if (!p) return;
+	const cg_vertex_format& format = cg_vertex_format_of(false);
+	glUseProgram(p);
+	GLuint vao = batch ? 0 : vaos.get(p, grid_buffers.vertex_buffer, grid_buffers.index_buffer, format);
+	if (vao) glBindVertexArray(vao);
+	else if (!batch) { cg_bind_vertex_format(p, grid_buffers.vertex_buffer, format); grid_buffers.bind(); }
+
+	grid_batch.clear();
+	float aspect_ratio = window_size.x / float(window_size.y), s = 0.8f / grid_size;
+	for (uint i = 0; i < grid_size; i++) for (uint j = 0; j < grid_size; j++)
+	{
+		mat4 mvp = model_view_projection(mat4::translate(0, (2 * i + 1) / float(grid_size) - 1, (2 * j + 1) / float(grid_size) - 1) * mat4::scale(s, s, s), aspect_ratio);
+		float row[16]; cg_store_std140(row, mvp);
+		if (batch) { grid_batch.add(grid_buffers, grid_mesh, row); continue; }
+		if (!bUniformBlocks) uniforms.set("model_view_projection", mvp);
+		else
+		{
+			size_t offset = uniform_ring.push(row, sizeof(row));
+			if (offset == SIZE_MAX) { static bool reported = false; if (!reported) printf("[error] the uniform ring is full: grid objects are skipped\n"); reported = true; continue; }
+			uniform_ring.bind(0, offset, sizeof(row));
+		}
+		grid_buffers.draw(grid_mesh);
+	}
+	if (batch) grid_batch.submit(p, grid_buffers, format, "model_view_projection");
+	if (vao) glBindVertexArray(0);
+	grid_time += glfwGetTime() - t0; grid_frames++;
+}
+
 //*******************************************************************
 void update()
 {
-	// update simulation
-	float t = float(glfwGetTime())*0.5f;
-	mat4 view_projection_matrix =
+	// hot reload: recompile on shader edits and swap the program only once it has linked successfully
+	if (shader_watcher.changed())
 	{
-		0, 1, 0, 0,
-		0, 0, 1, 0,
-	   -1, 0, 0, 1,
-		0, 0, 0, 1
-	};
+		char* vert_source = cg_read_shader(vert_shader_path);
+		char* frag_source = cg_read_shader(frag_shader_path);
+		std::string defines = shader_variants.defines(reload_key = shader_key());
+		if (vert_source && frag_source) program_reload.start(cg_insert_defines(vert_source, defines.c_str()).c_str(), cg_insert_defines(frag_source, defines.c_str()).c_str());
+		free(vert_source); free(frag_source);
+	}
+	if (program_reload.pending())
+	{
+		int status = program_reload.poll();
+		if (status > 0)	// other variants are stale and recompile on their next use
+		{
+			for (auto& e : shader_variants.programs) vaos.invalidate_program(e.second);
+			grid_batch.invalidate();
+			shader_variants.reset(reload_key, program_reload.take());
+			program = 0; select_program();
+			printf("> reloaded %s and %s\n", vert_shader_path, frag_shader_path);
+		}
+		else if (status < 0) printf("> shader reload failed; keeping the current program\n");
+	}
 
+	// update simulation
+	float t = float(glfwGetTime())*0.5f;
+	float st, ct; if(bFastTrig) fast_sincos(fmod(t,2*PI),st,ct); else { st=sin(t); ct=cos(t); }	// wrap t for fast_sincos() accuracy
 
 	mat4 rotation_matrix =				// explained later (in the transformation lecture)
 	{
-		cos(t), -sin(t), 0, 0,
-		sin(t), cos(t), 0, 0,
+		ct, -st, 0, 0,
+		st, ct, 0, 0,
 		0, 0, 1, 0,
 		0, 0, 0, 1
 	};
 
-	// update uniform variables in vertex/fragment shaders
-	GLint uloc;
+	mat4 mvp = model_view_projection(bRotation ? rotation_matrix : mat4(), window_size.x / float(window_size.y));
 
-	uloc = glGetUniformLocation(program, "projection_matrix"); if (uloc > -1) glUniformMatrix4fv(uloc, 1, GL_TRUE, view_projection_matrix);
-	uloc = glGetUniformLocation(program, "solid_color");		if (uloc > -1) glUniform1i(uloc, solid_color);
-	uloc = glGetUniformLocation(program, "bRotation");		if (uloc > -1) glUniform1i(uloc, bRotation);
-	uloc = glGetUniformLocation(program, "aspect_ratio");		if (uloc > -1) glUniform1f(uloc, window_size.x / float(window_size.y));
-	uloc = glGetUniformLocation(program, "radius");			if (uloc > -1) glUniform1f(uloc, radius);
-	uloc = glGetUniformLocation(program, "model_matrix");		if (uloc > -1) glUniformMatrix4fv(uloc, 1, GL_TRUE, rotation_matrix);
+	// update uniform variables in vertex/fragment shaders: only changed values are uploaded
+	glUseProgram(program);
+	if (bUniformBlocks)	// one memcpy into the mapped ring, and a range bind
+	{
+		object_block ob;
+		cg_store_std140(ob.model_view_projection, mvp);
+		uniform_ring.begin_frame();
+		size_t offset = uniform_ring.push(&ob, sizeof(ob));
+		if (offset != SIZE_MAX) { uniform_ring.bind(0, offset, sizeof(ob)); uniform_calls++; }
+	}
+	else if (bReflectedUniforms)
+	{
+		size_t calls = uniforms.gl_calls;
+		uniforms.set("model_view_projection", mvp);
+		uniform_calls += uniforms.gl_calls - calls;
+	}
+	else // per-frame lookups and uploads, kept for comparison
+	{
+		GLint uloc;
+		uloc = glGetUniformLocation(program, "model_view_projection"); uniform_calls++;
+		if (uloc > -1) { cg_set_uniform_matrix(uloc, mvp); uniform_calls++; }
+	}
+	uniform_frames++;
+
+	// swap in a background-loaded mesh once its uploads have completed
+	if (mesh_request && mesh_request->failed()) mesh_request.reset();
+	else if (mesh_request && mesh_request->ready())
+	{
+		if (loaded_mesh) { vaos.invalidate_buffer(loaded_mesh->vertex_buffer); vaos.invalidate_buffer(loaded_mesh->index_buffer); }
+		cg_delete_mesh(loaded_mesh);
+		loaded_mesh = mesh_request->result;
+		mesh_request.reset();
+		printf("> using %s (%d vertices)\n", mesh_export_path, int(loaded_mesh->vertex_count));
+	}
 }
 
 void render()
@@ -78,30 +246,42 @@ void render()
 	// notify GL that we use our own program
 	glUseProgram(program);
 
-	// bind vertex attributes to your shader program
-	const char*	vertex_attrib[] = { "position", "normal", "texcoord" };
-	size_t		attrib_size[] = { sizeof(vertex().pos), sizeof(vertex().norm), sizeof(vertex().tex) };
-	for (size_t k = 0, kn = std::extent<decltype(vertex_attrib)>::value, byte_offset = 0; k < kn; k++, byte_offset += attrib_size[k - 1])
-	{
-		GLuint loc = glGetAttribLocation(program, vertex_attrib[k]); if (loc >= kn) continue;
-		glEnableVertexAttribArray(loc);
-		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
-		glVertexAttribPointer(loc, attrib_size[k] / sizeof(GLfloat), GL_FLOAT, GL_FALSE, sizeof(vertex), (GLvoid*)byte_offset);
-	}
-
-	// render vertices: trigger shader programs to process vertex data
-	if (bUseIndexBuffer)
-	{
-		if (index_buffer) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
-		glDrawElements(GL_TRIANGLES, index_list.size(), GL_UNSIGNED_INT, nullptr);
-	}
+	// the object grid replaces the sphere
+	gpu_timer.begin();
+	if (bObjectGrid) render_object_grid();
 	else
 	{
-		glDrawArrays(GL_TRIANGLES, 0, NUM_TESS * (NUM_TESS * 2) * 2 * 3); // NUM_TESS = N
+		// the tessellated sphere is the placeholder until a loaded mesh is ready
+		GLuint		vb = loaded_mesh ? loaded_mesh->vertex_buffer : vertex_buffer;
+		GLuint		ib = loaded_mesh ? loaded_mesh->index_buffer : index_buffer;
+		bool		packed = loaded_mesh ? loaded_mesh->packed : bPackedVertices;
+
+		// bind vertex attributes to your shader program: one VAO bind, or the attribute setup without VAOs
+		double t0 = glfwGetTime();
+		const cg_vertex_format& format = cg_vertex_format_of(packed);
+		GLuint vao = bUseVAO ? vaos.get(program, vb, ib, format) : 0;
+		if (vao) glBindVertexArray(vao);
+		else { cg_bind_vertex_format(program, vb, format); if (ib) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ib); }
+
+		// render vertices: trigger shader programs to process vertex data
+		if (loaded_mesh)
+		{
+			if (ib) glDrawElements(GL_TRIANGLES, GLsizei(loaded_mesh->index_count), loaded_mesh->index_type, nullptr);
+			else glDrawArrays(GL_TRIANGLES, 0, GLsizei(loaded_mesh->vertex_count));
+		}
+		else if (bUseIndexBuffer)
+		{
+			glDrawElements(GL_TRIANGLES, index_list.size(), GL_UNSIGNED_INT, nullptr);
+		}
+		else
+		{
+			glDrawArrays(GL_TRIANGLES, 0, NUM_TESS * (NUM_TESS * 2) * 2 * 3); // NUM_TESS = N
+		}
+		if (vao) glBindVertexArray(0);	// keep later buffer binds out of the VAO
+		draw_time += glfwGetTime() - t0; draw_count++;
 	}
-
-	// swap front and back buffers, and display to screen
-	glfwSwapBuffers(window);
+	gpu_timer.end();
+	if (bUniformBlocks) uniform_ring.end_frame();	// fence the region the draws read
 }
 
 void reshape(GLFWwindow* window, int width, int height)
@@ -117,13 +297,198 @@ void print_help()
 	printf("[help]\n");
 	printf("- press ESC or 'q' to terminate the program\n");
 	printf("- press F1 or 'h' to see help\n");
+	printf("- press F2 to see frame-time statistics (p50/p95/p99/max), F3 to dump them to %s\n", frame_stats_path);
 	printf("- press 'w' to toggle wireframe\n");
 	printf("- press 'd' to toggle (tc.xy, 0) > (tc.xxx, 1) > (tc.yyy, 1)\n");
 	printf("- press 'r' to rotate the sphere\n");
+	printf("- press 'f' to toggle fast_sincos/libm trigonometry\n");
+	printf("- press 'p' to toggle packed/float vertex attributes\n");
+	printf("- press 'e' to export the sphere to %s (shift+'e': compressed)\n", mesh_export_path);
+	printf("- press 'l' to load/unload the exported sphere in the background\n");
+	printf("- press 'c' to time compiling 128 shader variants one by one and as a batch\n");
+	printf("- press 'u' to toggle reflected/per-frame uniforms (logs GL calls per frame)\n");
+	printf("- press 'v' to toggle VAOs/per-frame attribute setup (logs CPU time per draw)\n");
+	printf("- press 'b' to time rebuilding the sphere buffers every frame for 300 frames (delete/recreate vs. reuse)\n");
+	printf("- press 'g' to time fragment shading at 3840x2160 with uniform branches vs. the current shader permutation\n");
+	printf("- press 't' to time vertex transforms at N=4096 with separate matrices vs. the CPU-side model-view-projection\n");
+	printf("- press 'o' to toggle a grid of %u spheres\n", grid_size * grid_size);
+	printf("- press 'm' to toggle multi-draw indirect/a draw per object for the grid (logs CPU time per frame)\n");
 
 	printf("\n");
 }
 
+// compile count variants of the circle shaders one by one, then as one batch;
+// a per-run salt in every variant keeps driver shader caches from hitting
+void benchmark_program_compilation(uint count)
+{
+	char* vert_source = cg_read_shader(vert_shader_path);
+	char* frag_source = cg_read_shader(frag_shader_path);
+	if (!vert_source || !frag_source) { free(vert_source); free(frag_source); return; }
+
+	uint salt = uint(glfwGetTime() * 1000.0);
+	auto variant = [salt](const char* source, uint k)
+	{
+		char define[64]; snprintf(define, sizeof(define), "#define VARIANT_%u_%u\n", salt, k);
+		return cg_insert_defines(cg_insert_defines(source, shader_variants.defines(shader_key()).c_str()).c_str(), define);	// defines go after the #version line
+	};
+	std::vector<std::string> vert_variants, frag_variants;
+	for (uint k = 0; k < count * 2; k++) { vert_variants.push_back(variant(vert_source, k)); frag_variants.push_back(variant(frag_source, k)); }
+	free(vert_source); free(frag_source);
+
+	double t0 = glfwGetTime();
+	int failed = 0;
+	for (uint k = 0; k < count; k++)
+	{
+		GLuint p = cg_create_program_from_string(vert_variants[k].c_str(), frag_variants[k].c_str());
+		if (p) glDeleteProgram(p); else failed++;
+	}
+	double t1 = glfwGetTime();
+	std::vector<std::pair<const char*, const char*>> sources;
+	for (uint k = count; k < count * 2; k++) sources.push_back(std::make_pair(vert_variants[k].c_str(), frag_variants[k].c_str()));
+	std::vector<GLuint> programs = cg_create_programs_from_strings(sources);
+	double t2 = glfwGetTime();
+	for (GLuint p : programs) if (p) glDeleteProgram(p); else failed++;
+
+	glUseProgram(program);
+	printf("> %u programs: one by one %.1f ms, batch %.1f ms (%d failed)\n", count, (t1 - t0) * 1000.0, (t2 - t1) * 1000.0, failed);
+}
+
+// sets the loose uniforms of any shader variant for a fixed model, then times frames of layers draws of the
+// given sphere buffers; in uniform-block mode, the ring keeps the ranges bound by the last update()
+double time_sphere_draws(GLuint p, uint frames, uint layers, float aspect_ratio, GLuint vb, GLuint ib, size_t index_count, bool packed)
+{
+	cg_uniforms u; u.reflect(p);
+	glUseProgram(p);
+	u.set("model_view_projection", model_view_projection(mat4(), aspect_ratio));
+	u.set("projection_matrix", view_projection_matrix);	// the SEPARATE_MATRICES variant
+	u.set("aspect_ratio", aspect_ratio);
+	u.set("radius", radius);
+	u.set("model_matrix", mat4());
+	u.set("solid_color", solid_color);					// the DYNAMIC_BRANCHES variant
+	const cg_vertex_format& format = cg_vertex_format_of(packed);
+	GLuint vao = vaos.get(p, vb, ib, format);
+	if (vao) glBindVertexArray(vao);
+	else { cg_bind_vertex_format(p, vb, format); glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ib); }
+	glFinish();
+	double t0 = glfwGetTime();
+	for (uint f = 0; f < frames; f++)
+	{
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		for (uint k = 0; k < layers; k++) glDrawElements(GL_TRIANGLES, GLsizei(index_count), GL_UNSIGNED_INT, nullptr);
+	}
+	glFinish();
+	if (vao) glBindVertexArray(0);
+	return (glfwGetTime() - t0) * 1000.0 / frames;
+}
+
+// creates a variant of the current program with extra defines for comparison; bound like shader_variants
+GLuint create_comparison_program(const char* defines)
+{
+	std::string d = shader_variants.defines(shader_key()) + defines;
+	GLuint p = cg_create_program(vert_shader_path, frag_shader_path, program_cache_dir, d.c_str());
+	if (p) bind_uniform_blocks(p);
+	return p;
+}
+
+// restores the state the benchmarks changed
+void end_benchmark(GLuint comparison)
+{
+	if (comparison) { vaos.invalidate_program(comparison); glDeleteProgram(comparison); }
+	glViewport(0, 0, window_size.x, window_size.y);
+	glEnable(GL_DEPTH_TEST);
+	glUseProgram(program);
+	uniforms.reflect(program);	// the runs bypassed its shadow copies
+}
+
+// draw the sphere layers times per frame into an offscreen 3840x2160 target without depth tests, so the
+// fragment shader dominates: first with one program branching on uniforms, then with the current permutation
+void benchmark_fragment_shading(uint frames, uint layers)
+{
+	if (!glGenFramebuffers) { printf("> framebuffer objects are not supported\n"); return; }
+	const GLsizei width = 3840, height = 2160;
+	GLuint fbo = 0, color = 0;
+	glGenRenderbuffers(1, &color); glBindRenderbuffer(GL_RENDERBUFFER, color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenFramebuffers(1, &fbo); glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+	GLuint branching = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE ? create_comparison_program("#define DYNAMIC_BRANCHES\n") : 0;
+	if (branching)
+	{
+		glViewport(0, 0, width, height);
+		glDisable(GL_DEPTH_TEST);
+		double branched = time_sphere_draws(branching, frames, layers, width / float(height), vertex_buffer, index_buffer, index_list.size(), bPackedVertices);
+		double permuted = time_sphere_draws(program, frames, layers, width / float(height), vertex_buffer, index_buffer, index_list.size(), bPackedVertices);
+		printf("> %dx%d, %u layers: uniform branches %.2f ms, permutation %.2f ms per frame (%.2fx)\n", int(width), int(height), layers, branched, permuted, branched / max(permuted, 1e-6));
+	}
+	else printf("> unable to create the offscreen target or the branching program\n");
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteRenderbuffers(1, &color);
+	end_benchmark(branching);
+}
+
+// tessellate the sphere at N and draw it into a 16x16 viewport, so the vertex shader dominates: first
+// concatenating the separate matrices per vertex, then with the CPU-side model-view-projection matrix.
+// The geometry goes into its own buffers, deleted afterwards (cg_buffer never shrinks), and bypasses the
+// tessellation cache, so the interactive sphere and the cache directory are left as they were
+void benchmark_vertex_transform(uint N, uint frames)
+{
+	cg_buffer vb(GL_ARRAY_BUFFER), ib(GL_ELEMENT_ARRAY_BUFFER);
+	size_t vertex_count, index_count;
+	{
+		std::vector<vertex> vertices; std::vector<uint> indices;	// indexed: N=4096 without indices would be 200M vertices
+		cg_tessellate_sphere(N, radius, bFastTrig, vertices, indices);
+		if (bPackedVertices) { std::vector<packed_vertex> packed = cg_pack_vertices(vertices); vb.upload(&packed[0], sizeof(packed_vertex)*packed.size()); }
+		else vb.upload(&vertices[0], sizeof(vertex)*vertices.size());
+		ib.upload(&indices[0], sizeof(uint)*indices.size());
+		vertex_count = vertices.size(); index_count = indices.size();
+	}
+
+	GLuint separate = create_comparison_program("#define SEPARATE_MATRICES\n");
+	if (separate)
+	{
+		glViewport(0, 0, 16, 16);
+		double separated = time_sphere_draws(separate, frames, 1, 1.0f, vb, ib, index_count, bPackedVertices);
+		double combined = time_sphere_draws(program, frames, 1, 1.0f, vb, ib, index_count, bPackedVertices);
+		double vertices = double(vertex_count) / 1e6;
+		printf("> N=%u (%.1fM vertices): separate matrices %.2f ms (%.0fM vertices/s), model-view-projection %.2f ms (%.0fM vertices/s)\n",
+			N, vertices, separated, vertices * 1000.0 / max(separated, 1e-6), combined, vertices * 1000.0 / max(combined, 1e-6));
+	}
+	else printf("> unable to create the separate-matrix program\n");
+	end_benchmark(separate);
+
+	// delete the large buffers rather than pooling their names and storage
+	vaos.invalidate_buffer(vb); vaos.invalidate_buffer(ib);
+	vb.destroy(); ib.destroy();
+}
+
+// rebuild the sphere buffers every frame, first deleting and recreating them as before, then reusing their storage
+void benchmark_buffer_rebuild(uint frames)
+{
+	void update_vertex_buffer(uint N);	// forward declaration
+	for (int reuse = 0; reuse < 2; reuse++)
+	{
+		if (!reuse) { vaos.clear(); cg_buffer::clear_pool(); }	// no pooled names either
+		cg_buffer_stats s0 = cg_buffer::stats();
+		double rebuild = 0, t0 = glfwGetTime();
+		for (uint k = 0; k < frames; k++)
+		{
+			double t = glfwGetTime();
+			if (!reuse) { vaos.invalidate_buffer(vertex_buffer); vaos.invalidate_buffer(index_buffer); vertex_buffer.destroy(); index_buffer.destroy(); }
+			update_vertex_buffer(NUM_TESS);
+			rebuild += glfwGetTime() - t;
+			render();
+			glfwSwapBuffers(window);
+		}
+		glFinish();
+		const cg_buffer_stats& s1 = cg_buffer::stats();
+		printf("> %s: rebuild %.3f ms, frame %.3f ms; per frame %.2f names, %.2f allocations, %.2f orphans\n", reuse ? "reuse" : "delete/recreate",
+			rebuild * 1000.0 / frames, (glfwGetTime() - t0) * 1000.0 / frames,
+			double(s1.names - s0.names) / frames, double(s1.allocations - s0.allocations) / frames, double(s1.orphans - s0.orphans) / frames);
+	}
+}
+
 void keyboard(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
 	void update_vertex_buffer(uint N);	// forward declaration
@@ -133,6 +498,11 @@ void keyboard(GLFWwindow* window, int key, int scancode, int action, int mods)
 	{
 		if (key == GLFW_KEY_ESCAPE || key == GLFW_KEY_Q)	glfwSetWindowShouldClose(window, GL_TRUE);
 		else if (key == GLFW_KEY_H || key == GLFW_KEY_F1)	print_help();
+		else if (key == GLFW_KEY_F2)	frame_stats.print(gpu_timer.queries[0][0] ? &gpu_timer : nullptr);
+		else if (key == GLFW_KEY_F3)
+		{
+			if (frame_stats.save_csv(frame_stats_path, gpu_timer.queries[0][0] ? &gpu_timer : nullptr)) printf("> saved %zu frames to %s\n", frame_stats.frame.count, frame_stats_path);
+		}
 		else if (key == GLFW_KEY_W)
 		{
 			bWireframe = !bWireframe;
@@ -149,12 +519,91 @@ void keyboard(GLFWwindow* window, int key, int scancode, int action, int mods)
 				printf("> using (texcord.xxx, 1)\n");
 			else if (solid_color == 2)
 				printf("> using (texcord.yyy, 1)\n");
+			select_program();
 		}
 
 		else if (key == GLFW_KEY_R)
 		{
 			bRotation = !bRotation;
 		}
+
+		else if (key == GLFW_KEY_F)
+		{
+			bFastTrig = !bFastTrig;
+			update_sphere_vertices(NUM_TESS);
+			update_vertex_buffer(NUM_TESS);
+			printf("> using %s trigonometry\n", bFastTrig ? "fast_sincos" : "libm");
+		}
+
+		else if (key == GLFW_KEY_P)
+		{
+			bPackedVertices = !bPackedVertices;
+			update_sphere_vertices(NUM_TESS);	// the vertex layout is part of the tessellation cache key
+			update_vertex_buffer(NUM_TESS);
+			printf("> using %s vertices (%d bytes)\n", bPackedVertices ? "packed" : "float", int(bPackedVertices ? sizeof(packed_vertex) : sizeof(vertex)));
+		}
+
+		else if (key == GLFW_KEY_E)
+		{
+			if (cg_save_mesh_file(mesh_export_path, vertex_list, index_list, bPackedVertices, (mods & GLFW_MOD_SHIFT) ? CG_CODEC_QLZ : CG_CODEC_NONE))
+				printf("> exported %d vertices and %d indices to %s\n", int(vertex_list.size()), int(index_list.size()), mesh_export_path);
+		}
+
+		else if (key == GLFW_KEY_C)
+		{
+			benchmark_program_compilation(128);
+		}
+
+		else if (key == GLFW_KEY_U)
+		{
+			printf("> %s uniforms: %.2f GL calls per frame over %zu frames\n", bUniformBlocks ? "uniform-block" : bReflectedUniforms ? "reflected" : "per-frame", double(uniform_calls) / max(uniform_frames, size_t(1)), uniform_frames);
+			bReflectedUniforms = !bReflectedUniforms;
+			uniform_calls = uniform_frames = 0;
+			printf("> using %s uniforms\n", bReflectedUniforms ? "reflected" : "per-frame");
+		}
+
+		else if (key == GLFW_KEY_V)
+		{
+			printf("> %s: %.2f us CPU per draw over %zu draws (%zu VAOs built)\n", bUseVAO ? "VAO" : "attribute setup", draw_time * 1e6 / max(draw_count, size_t(1)), draw_count, vaos.builds);
+			bUseVAO = !bUseVAO;
+			draw_time = 0; draw_count = 0;
+			printf("> using %s\n", bUseVAO && cg_vao_cache::supported() ? "VAOs" : "per-frame attribute setup");
+		}
+
+		else if (key == GLFW_KEY_B)
+		{
+			benchmark_buffer_rebuild(300);
+		}
+
+		else if (key == GLFW_KEY_G)
+		{
+			benchmark_fragment_shading(100, 16);
+		}
+
+		else if (key == GLFW_KEY_T)
+		{
+			benchmark_vertex_transform(4096, 20);
+		}
+
+		else if (key == GLFW_KEY_O)
+		{
+			bObjectGrid = !bObjectGrid && init_object_grid();
+			printf("> drawing %s\n", bObjectGrid ? "a grid of spheres" : "the sphere");
+		}
+
+		else if (key == GLFW_KEY_M)
+		{
+			printf("> %s: %.3f ms CPU per frame over %zu frames for %u objects\n", bBatchDraws && cg_draw_batch::supported() ? "multi-draw indirect" : "draw per object", grid_time * 1000.0 / max(grid_frames, size_t(1)), grid_frames, grid_size * grid_size);
+			bBatchDraws = !bBatchDraws;
+			grid_time = 0; grid_frames = 0;
+			printf("> using %s\n", bBatchDraws && cg_draw_batch::supported() ? "multi-draw indirect" : "a draw per object");
+		}
+
+		else if (key == GLFW_KEY_L)
+		{
+			if (loaded_mesh) { vaos.invalidate_buffer(loaded_mesh->vertex_buffer); vaos.invalidate_buffer(loaded_mesh->index_buffer); cg_delete_mesh(loaded_mesh); printf("> using the tessellated sphere\n"); }
+			else if (!mesh_request) { mesh_request = loader.load(mesh_export_path); printf("> loading %s in the background\n", mesh_export_path); }
+		}
 	}
 }
 
@@ -171,45 +620,28 @@ void motion(GLFWwindow* window, double x, double y)
 {
 }
 
-void update_vertex_buffer(uint N)
+void upload_vertex_buffer(const std::vector<vertex>& vertices)
 {
-	// clear and create new buffers
-	if (vertex_buffer)	glDeleteBuffers(1, &vertex_buffer);	vertex_buffer = 0;
-	if (index_buffer)	glDeleteBuffers(1, &index_buffer);	index_buffer = 0;
+	if (!bPackedVertices) { vertex_buffer.upload(&vertices[0], sizeof(vertex)*vertices.size()); return; }
 
-	// check exceptions
+	// pack normals and texture coordinates on upload
+	std::vector<packed_vertex> packed = cg_pack_vertices(vertices);
+	vertex_buffer.upload(&packed[0], sizeof(packed_vertex)*packed.size());
+}
+
+void update_vertex_buffer(uint N)
+{
+	// check exceptions; buffers keep their names and storage, and are refilled below
 	if (vertex_list.empty()) { printf("[error] vertex_list is empty.\n"); return; }
 
-	// create buffers
+	// create buffers; index_list comes with the vertices from update_sphere_vertices()
 	if (bUseIndexBuffer)
 	{
-		index_list.clear();
-		for (uint i = 0; i < N; i++)
-		{
-			for (uint k = 0; k < N * 2; k++)
-			{
-
-				index_list.push_back((N * 2 + 1) * i + (k + 1));
-				index_list.push_back((N * 2 + 1) * (i + 1) + k);
-				index_list.push_back((N * 2 + 1) * (i + 1) + (k + 1));
-
-				index_list.push_back((N * 2 + 1) * (i + 1) + k);
-				index_list.push_back((N * 2 + 1) * i + (k + 1));
-				index_list.push_back((N * 2 + 1) * i + k);
-
-
-			}
-		}
-
 		// generation of vertex buffer: use vertex_list as it is
-		glGenBuffers(1, &vertex_buffer);
-		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(vertex)*vertex_list.size(), &vertex_list[0], GL_STATIC_DRAW);
+		upload_vertex_buffer(vertex_list);
 
 		// geneation of index buffer
-		glGenBuffers(1, &index_buffer);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint)*index_list.size(), &index_list[0], GL_STATIC_DRAW);
+		index_buffer.upload(&index_list[0], sizeof(uint)*index_list.size());
 	}
 	else
 	{
@@ -229,31 +661,29 @@ void update_vertex_buffer(uint N)
 		}
 
 		// generation of vertex buffer: use triangle_vertices instead of vertex_list
-		glGenBuffers(1, &vertex_buffer);
-		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(vertex)*triangle_vertices.size(), &triangle_vertices[0], GL_STATIC_DRAW);
+		upload_vertex_buffer(triangle_vertices);
+		index_buffer.release();
 
 	}
 }
 
 void update_sphere_vertices(uint N)
 {
-	vertex_list.clear();
-
-	for (uint i = 0; i <= N; i++)
+	// look up the tessellation cache: a hit maps the stored vertices and indices instead of generating them
+	cg_sphere_params params = cg_sphere_key(N, radius, bFastTrig, bPackedVertices);
+	double t0 = glfwGetTime();
+	std::string cache_path = cg_tessellation_cache_path(tessellation_cache_dir, &params, sizeof(params));
+	if (cg_load_tessellation(cache_path.c_str(), vertex_list, index_list))
 	{
-		float alpha = PI * 1.0f / float(N) * float(i);
-		for (uint k = 0; k <= N * 2; k++)
-		{
-			float beta = PI * 2.0f / float(N * 2) * float(k);
-			vertex_list.push_back
-			({
-				vec3(radius * sin(alpha) * cos(beta), radius * sin(alpha) * sin(beta), radius * cos(alpha)),  //vertex position
-				vec3(sin(alpha) * cos(beta), sin(alpha) * sin(beta), cos(alpha)),                             //normal vector facing your eye
-				vec2(beta / (2 * PI), 1 - alpha / PI)														  //texture coordinate
-			});
-		}
+		printf("> tessellation N=%u: cache hit in %.1f ms\n", N, (glfwGetTime() - t0) * 1000.0);
+		return;
 	}
+
+	cg_tessellate_sphere(N, radius, bFastTrig, vertex_list, index_list);
+
+	// store the result for the next run
+	cg_save_tessellation(tessellation_cache_dir, cache_path.c_str(), vertex_list, index_list, bPackedVertices);
+	printf("> tessellation N=%u: cache miss in %.1f ms\n", N, (glfwGetTime() - t0) * 1000.0);
 }
 
 bool user_init()
@@ -273,11 +703,36 @@ bool user_init()
 	// create vertex buffer; called again when index buffering mode is toggled
 	update_vertex_buffer(NUM_TESS);
 
+	// watch the shader files for hot reload
+	shader_watcher.add(vert_shader_path);
+	shader_watcher.add(frag_shader_path);
+
+	// start the background loader; a previously exported sphere is loaded while the tessellated one is drawn
+	if (loader.start(window))
+	{
+		FILE* fp = fopen(mesh_export_path, "rb");
+		if (fp) { fclose(fp); mesh_request = loader.load(mesh_export_path); }
+	}
+
 	return true;
 }
 
 void user_finalize()
 {
+	program_reload.cancel();
+	loader.stop();
+	if (mesh_request && mesh_request->wait()) cg_delete_mesh(mesh_request->result);	// the worker has stopped; its uploads may still be in flight
+	mesh_request.reset();
+	vaos.clear();
+	uniform_ring.release();
+	gpu_timer.release();
+	grid_batch.release();
+	grid_buffers.release();
+	shader_variants.clear(); program = 0;
+	cg_delete_mesh(loaded_mesh);
+	vertex_buffer.destroy();
+	index_buffer.destroy();
+	cg_buffer::clear_pool();
 }
 
 void main(int argc, char* argv[])
@@ -290,8 +745,15 @@ void main(int argc, char* argv[])
 	if (!cg_init_extensions(window)) { glfwTerminate(); return; }	// init OpenGL extensions
 
 	// initializations and validations of GLSL program
-	if (!(program = cg_create_program(vert_shader_path, frag_shader_path))) { glfwTerminate(); return; }	// create and compile shaders/program
+	bUniformBlocks = uniform_ring.init(sizeof(object_block), grid_size * grid_size + 1);	// a range per grid object and the sphere; loose uniforms without persistent mapping
+	shader_defines = bUniformBlocks ? "#define UNIFORM_BLOCKS\n" : nullptr;
+	shader_variants.init(vert_shader_path, frag_shader_path, program_cache_dir, shader_defines, shader_variant_defines);
+	shader_variants.on_create = bind_uniform_blocks;
+	shader_variants.precompile({ 0, 1, 2 });	// every color variant ahead of time; batched ones on first use
+	if (!(program = shader_variants.get(shader_key()))) { glfwTerminate(); return; }	// create and compile shaders/program
+	uniforms.reflect(program);
 	if (!user_init()) { printf("Failed to user_init()\n"); glfwTerminate(); return; }					// user initialization
+	gpu_timer.init();	// without timer queries, the statistics cover the CPU phases only
 
 	// register event callbacks
 	glfwSetWindowSizeCallback(window, reshape);	// callback for window resizing events
@@ -302,9 +764,16 @@ void main(int argc, char* argv[])
 	// enters rendering/event loop
 	for (frame = 0; !glfwWindowShouldClose(window); frame++)
 	{
+		frame_stats.begin_frame();
 		glfwPollEvents();	// polling and processing of events
+		frame_stats.lap(phase_poll);
 		update();			// per-frame update
+		frame_stats.lap(phase_update);
 		render();			// per-frame render
+		frame_stats.lap(phase_render);
+		glfwSwapBuffers(window);	// swap front and back buffers, and display to screen
+		frame_stats.lap(phase_swap);
+		frame_stats.end_frame();
 	}
 
 	// normal termination